@@ -0,0 +1,108 @@
+// MIT license
+// Copyright 2021 highvoltglow
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), to deal in the Software without restriction, 
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, 
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software 
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR 
+// OTHER DEALINGS IN THE SOFTWARE.
+
+
+// Linux fan-out daemon
+// owns the serial port, decodes once and publishes every update to local subscribers
+// build: g++ -std=c++11 -I host -I . Examples/broadcast.cpp ubGPSTime.cpp ubGPSLinuxSerial.cpp ubGPSTimeBroadcast.cpp host/Arduino.cpp -o broadcast -lrt
+// usage: broadcast /dev/ttyACM0 [baud] [raw]
+
+#include <Arduino.h>
+#include <ubGPSTime.h>
+#include <ubGPSLinuxSerial.h>
+#include <ubGPSTimeBroadcast.h>
+
+// globals
+ubGPSLinuxSerial gpsCom;
+ubGPSTime gps;
+ubGPSTimePublisher publisher;
+bool publishRaw = false;
+
+// message event, publish decoded data and optionally the raw frame
+void onGPSMessage(UBXMESSAGE *message)
+{
+  if(message->msgClass == UBX_NAV)
+  {
+    switch(message->msgID)
+    {
+      case UBX_NAV_TIMEUTC:
+        publisher.publishTimeUTC(gps.getTimeUTC());
+        break;
+
+      case UBX_NAV_STATUS:
+        publisher.publishGPSStatus(gps.getGPSStatus());
+        break;
+
+      case UBX_NAV_PVT:
+        publisher.publishTimeUTC(gps.getTimeUTC());
+        publisher.publishGPSStatus(gps.getGPSStatus());
+        break;
+    }
+  }
+  if(publishRaw)
+  {
+    publisher.publishMessage(message);
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  uint32_t baudRate = argc > 2 ? atoi(argv[2]) : 9600;
+  publishRaw = (argc > 3) && (strcmp(argv[3], "raw") == 0);
+
+  if((argc < 2) || !gpsCom.open(argv[1], baudRate))
+  {
+    Serial.println("Failed to open serial port");
+    return (1);
+  }
+  if(!publisher.open())
+  {
+    Serial.println("Failed to create broadcast ring");
+    return (1);
+  }
+  gps.begin(gpsCom, baudRate);
+  gps.initialize();
+  if(!gps.isInitialized())
+  {
+    Serial.println("Failed to initialize GPS module");
+    return (1);
+  }
+  gps.attach(onGPSMessage);
+  gps.subscribeTimeUTC(1);
+  gps.subscribeGPSStatus(5);
+
+  uint32_t timestamp = millis();
+  while(true)
+  {
+    if(gpsCom.waitForData(100))
+    {
+      gps.process();
+    }
+    publisher.process();
+    if(millis() - timestamp >= 10000)
+    {
+      timestamp = millis();
+      Serial.printf("subscribers: %u publish time: %u ns (max %u ns)\n",
+        publisher.getStats().subscribers,
+        publisher.getStats().lastPublishTime,
+        publisher.getStats().maxPublishTime);
+    }
+  }
+  return (0);
+}
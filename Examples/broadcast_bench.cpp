@@ -0,0 +1,160 @@
+// MIT license
+// Copyright 2021 highvoltglow
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), to deal in the Software without restriction, 
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, 
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software 
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR 
+// OTHER DEALINGS IN THE SOFTWARE.
+
+
+// publish latency benchmark for the fan-out daemon, no receiver needed
+// forks subscriber processes and publishes NAV-TIMEUTC sized entries to all of them
+// build: g++ -std=c++11 -O2 -I host -I . Examples/broadcast_bench.cpp ubGPSTime.cpp ubGPSTimeBroadcast.cpp host/Arduino.cpp -o broadcast_bench -lrt
+// usage: broadcast_bench [subscribers] [entries]
+
+#include <Arduino.h>
+#include <ubGPSTime.h>
+#include <ubGPSTimeBroadcast.h>
+#include <algorithm>
+#include <vector>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_NAME "/ubgpstime_bench"
+#define BENCH_SOCKET "/tmp/ubgpstime_bench.sock"
+#define BENCH_INTERVAL 1000 // us between published entries
+
+// wake up latency of one subscriber
+typedef struct
+{
+  uint32_t received;
+  uint32_t lost;
+  uint64_t meanLatency; // ns from publish to read
+  uint64_t maxLatency;
+}
+BENCHRESULT;
+
+static uint64_t monotonicTime()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return ((uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec);
+}
+
+// subscriber process, reads until all entries arrived or the publisher stops
+void subscribe(int result, uint32_t entries)
+{
+  ubGPSTimeSubscriber subscriber;
+  BENCHRESULT stats = {};
+  uint64_t total = 0;
+
+  if(subscriber.open(BENCH_NAME, BENCH_SOCKET))
+  {
+    while((stats.received + subscriber.getLost() < entries) && subscriber.wait(2000))
+    {
+      const BROADCASTSLOT *slot;
+      while((slot = subscriber.peek()) != nullptr)
+      {
+        uint64_t latency = monotonicTime() - slot->publishTime;
+        if(subscriber.consume())
+        {
+          stats.received++;
+          total += latency;
+          stats.maxLatency = std::max(stats.maxLatency, latency);
+        }
+      }
+    }
+    stats.lost = (uint32_t) subscriber.getLost();
+    stats.meanLatency = stats.received ? total / stats.received : 0;
+  }
+  if(write(result, &stats, sizeof(stats)) != sizeof(stats))
+  {
+    _exit(1);
+  }
+  subscriber.close();
+  _exit(0);
+}
+
+int main(int argc, char *argv[])
+{
+  uint32_t subscribers = argc > 1 ? atoi(argv[1]) : 100;
+  uint32_t entries = argc > 2 ? atoi(argv[2]) : 1000;
+  ubGPSTimePublisher publisher;
+  int result[2];
+
+  if((subscribers > BROADCAST_MAX_SUBSCRIBERS) || (pipe(result) < 0) || 
+    !publisher.open(BENCH_NAME, BENCH_SOCKET))
+  {
+    Serial.println("Failed to create broadcast ring");
+    return (1);
+  }
+  for(uint32_t i = 0; i < subscribers; i++)
+  {
+    if(fork() == 0)
+    {
+      ::close(result[0]);
+      subscribe(result[1], entries);
+    }
+  }
+  ::close(result[1]);
+
+  // wait for all registrations
+  uint32_t timestamp = millis();
+  while((publisher.getStats().subscribers < subscribers) && (millis() - timestamp < 5000))
+  {
+    publisher.process();
+    delay(1);
+  }
+  Serial.printf("subscribers: %u\n", publisher.getStats().subscribers);
+
+  TIMEUTC time = {};
+  std::vector<uint32_t> publishTimes;
+  for(uint32_t i = 0; i < entries; i++)
+  {
+    time.timeOfWeek = i * 1000;
+    publisher.publishTimeUTC(time);
+    publishTimes.push_back(publisher.getStats().lastPublishTime);
+    usleep(BENCH_INTERVAL);
+  }
+  std::sort(publishTimes.begin(), publishTimes.end());
+  Serial.printf("publish time: median %u ns, 99%% %u ns, max %u ns, notifications dropped %u\n",
+    publishTimes[publishTimes.size() / 2],
+    publishTimes[publishTimes.size() * 99 / 100],
+    publishTimes.back(),
+    publisher.getStats().notificationsDropped);
+
+  BENCHRESULT stats;
+  uint64_t received = 0;
+  uint64_t lost = 0;
+  uint64_t mean = 0;
+  uint64_t max = 0;
+  uint32_t reports = 0;
+  while(read(result[0], &stats, sizeof(stats)) == sizeof(stats))
+  {
+    received += stats.received;
+    lost += stats.lost;
+    mean += stats.meanLatency;
+    max = std::max(max, stats.maxLatency);
+    reports++;
+  }
+  while(wait(nullptr) > 0)
+  {
+  }
+  Serial.printf("received: %llu lost: %llu wake latency: mean %llu ns, max %llu ns\n",
+    (unsigned long long) received, (unsigned long long) lost,
+    (unsigned long long)(reports ? mean / reports : 0), (unsigned long long) max);
+  publisher.close();
+  return (0);
+}
@@ -44,8 +44,9 @@ void setup()
   // use default speed
   gpsCom.begin(9600);
 
-  // define com port
-  gps.begin(gpsCom);
+  // define com port, the baud rate is used to compensate the 
+  // serial transfer time of the receive timestamps
+  gps.begin(gpsCom, 9600);
 
   // uncomment to get some extra information
   // gps.enableVerbose(Serial);
@@ -69,6 +70,8 @@ void setup()
       Serial.printf("Extension %u: ", i+1);
       Serial.println(gps.getModuleVersion().extensions[i]);
     }
+    // decoded capabilities, e.g. PROTVER=18.00 -> 1800
+    Serial.printf("Protocol version: %u\n", gps.getModuleCaps().protocolVersion);
 
     // set notification callback 
     // you can stop getting notificatons by calling the detach function
@@ -79,13 +82,21 @@ void setup()
     gps.subscribeGPSStatus(5); 
     gps.subscribeTimeUTC(1);
 
+    // alternatively, NAV-PVT delivers date/time and GPS status 
+    // of the same navigation epoch in a single message
+    // gps.subscribePVT(1);
+
     // if you switch off the gps module, all configuation changes 
     // (subscriptions, NMEA unsubscriptions,...) will be lost and 
     // the module will restart with the default configuration 
+    // the restart is detected (NMEA output or missing NAV messages) and the 
+    // configuration is restored in the background, see gps.getRecoveryStats()
 
     // if you only wan't a single response, use the request functions
     // request functions will return without waiting for a response
-    // the gps module will discard requests if too many (> 5?) are sent in a row
+    // the gps module will discard requests if too many (> 5?) are sent in a row,
+    // requests are therefore queued and only MAX_POLLS_IN_FLIGHT are sent at once
+    // use gps.poll(msgClass, msgID, callBack) to get notified about the response or a timeout
     // gps.requestStatus();
     // gps.requestTimeUTC();
   }
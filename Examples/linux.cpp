@@ -0,0 +1,86 @@
+// MIT license
+// Copyright 2021 highvoltglow
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), to deal in the Software without restriction, 
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, 
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software 
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR 
+// OTHER DEALINGS IN THE SOFTWARE.
+
+
+// Linux host example
+// build: g++ -std=c++11 -I host -I . Examples/linux.cpp ubGPSTime.cpp ubGPSLinuxSerial.cpp ubGPSTimeSHM.cpp host/Arduino.cpp -o linux
+// usage: linux /dev/ttyACM0 [baud]
+
+#include <Arduino.h>
+#include <ubGPSTime.h>
+#include <ubGPSLinuxSerial.h>
+#include <ubGPSTimeSHM.h>
+
+// globals
+ubGPSLinuxSerial gpsCom;
+ubGPSTime gps;
+ubGPSTimeSHM refClock; // chrony: refclock SHM 0
+
+// message event, reports the time from waking up to the callback
+void onGPSMessage(UBXMESSAGE *message)
+{
+  if((message->msgClass == UBX_NAV) && (message->msgID == UBX_NAV_TIMEUTC))
+  {
+    Serial.printf("%02u:%02u:%02u UTC wake to callback: %u us\n",
+      gps.getTimeUTC().hour,
+      gps.getTimeUTC().minute,
+      gps.getTimeUTC().second,
+      gpsCom.getWakeLatency());
+
+    // feed chrony/ntpd, offset statistics are also collected without a time server
+    refClock.update(gps.getTimeUTC());
+    Serial.printf("offset mean: %.6f s jitter: %.6f s\n",
+      refClock.getStats().meanOffset,
+      refClock.getStats().jitter);
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  uint32_t baudRate = argc > 2 ? atoi(argv[2]) : 9600;
+
+  if((argc < 2) || !gpsCom.open(argv[1], baudRate))
+  {
+    Serial.println("Failed to open serial port");
+    return (1);
+  }
+  gps.begin(gpsCom, baudRate);
+  gps.initialize();
+  if(!gps.isInitialized())
+  {
+    Serial.println("Failed to initialize GPS module");
+    return (1);
+  }
+  if(!refClock.open(0))
+  {
+    Serial.println("Failed to open NTP shared memory segment, statistics only");
+  }
+  gps.attach(onGPSMessage);
+  gps.subscribeTimeUTC(1);
+
+  // sleep until bytes arrive instead of spinning on available()
+  while(true)
+  {
+    if(gpsCom.waitForData(1000))
+    {
+      gps.process();
+    }
+  }
+  return (0);
+}
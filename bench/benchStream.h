@@ -0,0 +1,158 @@
+// ubGPSTime
+// get utc time from u-blox gps module
+// designed for nixie clocks...
+// Version 0.1.3 (alpha)
+
+// MIT license
+// Copyright 2021 highvoltglow
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), to deal in the Software without restriction, 
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, 
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software 
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR 
+// OTHER DEALINGS IN THE SOFTWARE.
+
+// in-memory receiver stream and UBX frame builders for the host benchmarks
+// frames are appended up front, release() makes the bytes of one update readable
+
+#ifndef BENCHSTREAM_H
+#define BENCHSTREAM_H
+
+#include <Arduino.h>
+#include <ubGPSTime.h>
+#include <time.h>
+#include <vector>
+
+class BenchStream : public Stream
+{
+public:
+    // appends a frame with checksum
+    void frame(uint8_t msgClass, uint8_t msgID, const std::vector<uint8_t> &payload)
+    {
+        uint16_t length = (uint16_t) payload.size();
+        size_t start = _data.size();
+        _data.push_back(UBX_HEADER1);
+        _data.push_back(UBX_HEADER2);
+        _data.push_back(msgClass);
+        _data.push_back(msgID);
+        _data.push_back(length & 0xFF);
+        _data.push_back(length >> 8);
+        _data.insert(_data.end(), payload.begin(), payload.end());
+        uint8_t a = 0;
+        uint8_t b = 0;
+        for(size_t i = start + 2; i < _data.size(); i++)
+        {
+            a += _data[i];
+            b += a;
+        }
+        _data.push_back(a);
+        _data.push_back(b);
+    }
+
+    // appends raw bytes, e.g. NMEA sentences
+    void text(const char *text)
+    {
+        _data.insert(_data.end(), text, text + strlen(text));
+    }
+
+    // bytes appended so far, marks the end of an update
+    size_t size()
+    {
+        return (_data.size());
+    }
+
+    // makes the bytes up to end readable
+    void release(size_t end)
+    {
+        _limit = end;
+    }
+
+    // replays the stream from the start
+    void rewind()
+    {
+        _pos = 0;
+        _limit = 0;
+    }
+
+    int available() override { return ((int)(_limit - _pos)); }
+    int read() override { return (_pos < _limit ? _data[_pos++] : -1); }
+    int peek() override { return (_pos < _limit ? _data[_pos] : -1); }
+    size_t write(uint8_t) override { return (1); }
+    size_t write(const uint8_t *, size_t size) override { return (size); }
+    int availableForWrite() override { return (64); }
+
+private:
+    std::vector<uint8_t> _data;
+    size_t _pos = 0;
+    size_t _limit = 0;
+};
+
+// payload builders, epoch in seconds since 2024-01-01 12:00:00 (monday)
+inline void benchPut(std::vector<uint8_t> &p, size_t offset, uint32_t value, uint8_t size)
+{
+    for(uint8_t i = 0; i < size; i++)
+    {
+        p[offset + i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+inline std::vector<uint8_t> benchTimeUTC(uint32_t epoch)
+{
+    std::vector<uint8_t> p(20);
+    benchPut(p, 0, 216000000UL + epoch * 1000, 4);
+    benchPut(p, 4, 25, 4);
+    benchPut(p, 12, 2024, 2);
+    p[14] = 1;
+    p[15] = 1;
+    p[16] = 12 + epoch / 3600;
+    p[17] = (epoch / 60) % 60;
+    p[18] = epoch % 60;
+    p[19] = 0x07;
+    return (p);
+}
+
+inline std::vector<uint8_t> benchStatus(uint32_t epoch)
+{
+    std::vector<uint8_t> p(16);
+    benchPut(p, 0, 216000000UL + epoch * 1000, 4);
+    p[4] = 3;
+    p[5] = 0x0D;
+    return (p);
+}
+
+inline std::vector<uint8_t> benchPVT(uint32_t epoch)
+{
+    std::vector<uint8_t> p(92);
+    benchPut(p, 0, 216000000UL + epoch * 1000, 4);
+    benchPut(p, 4, 2024, 2);
+    p[6] = 1;
+    p[7] = 1;
+    p[8] = 12 + epoch / 3600;
+    p[9] = (epoch / 60) % 60;
+    p[10] = epoch % 60;
+    p[11] = 0x37; // date, time, fully resolved, confirmed
+    benchPut(p, 12, 25, 4);
+    p[20] = 3;
+    p[21] = 0x01;
+    return (p);
+}
+
+// CLOCK_MONOTONIC in ns
+inline uint64_t benchTime()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec);
+}
+
+#endif
@@ -0,0 +1,93 @@
+// ubGPSTime
+// get utc time from u-blox gps module
+// designed for nixie clocks...
+// Version 0.1.3 (alpha)
+
+// MIT license
+// Copyright 2021 highvoltglow
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), to deal in the Software without restriction, 
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, 
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software 
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR 
+// OTHER DEALINGS IN THE SOFTWARE.
+
+// message filter on a busy receiver: NAV-TIMEUTC and NAV-STATUS between raw measurement,
+// satellite and NMEA traffic, process() time per epoch with and without the filter
+// build: g++ -std=c++11 -O2 -I host -I . bench/filter_bench.cpp ubGPSTime.cpp host/Arduino.cpp -o filter_bench
+// usage: filter_bench [epochs]
+
+#include "benchStream.h"
+#include <algorithm>
+
+#define BENCH_PASSES 5
+
+// traffic of one epoch besides the wanted messages
+const uint8_t UBX_RXM = 0x02;
+const uint8_t UBX_RXM_RAWX = 0x15;
+const uint8_t UBX_NAV_SAT = 0x35;
+const uint16_t RAWX_LENGTH = 16 + 24 * 20; // 20 measurements
+const uint16_t SAT_LENGTH = 8 + 12 * 24; // 24 satellites
+
+int main(int argc, char *argv[])
+{
+    uint32_t epochs = argc > 1 ? atoi(argv[1]) : 20000;
+    BenchStream stream;
+    std::vector<size_t> ends;
+    std::vector<uint8_t> rawx(RAWX_LENGTH, 0x5A);
+    std::vector<uint8_t> sat(SAT_LENGTH, 0x3C);
+
+    for(uint32_t i = 0; i < epochs; i++)
+    {
+        uint32_t epoch = i % 3600;
+        stream.frame(UBX_RXM, UBX_RXM_RAWX, rawx);
+        stream.frame(UBX_NAV, UBX_NAV_SAT, sat);
+        stream.frame(UBX_NAV, UBX_NAV_TIMEUTC, benchTimeUTC(epoch));
+        stream.frame(UBX_NAV, UBX_NAV_STATUS, benchStatus(epoch));
+        stream.text("$GNGGA,120000.00,4717.11399,N,00833.91590,E,1,08,1.01,499.6,M,48.0,M,,*5B\r\n");
+        stream.text("$GNRMC,120000.00,A,4717.11399,N,00833.91590,E,0.004,77.52,010124,,,A*57\r\n");
+        ends.push_back(stream.size());
+    }
+
+    for(uint8_t filter = 0; filter < 2; filter++)
+    {
+        uint64_t total = UINT64_MAX;
+        uint32_t skipped = 0;
+        for(uint8_t pass = 0; pass < BENCH_PASSES; pass++)
+        {
+            ubGPSTime gps;
+            gps.begin(stream);
+            if(filter)
+            {
+                gps.enableFilter();
+                gps.acceptMessage(UBX_NAV, UBX_NAV_TIMEUTC);
+                gps.acceptMessage(UBX_NAV, UBX_NAV_STATUS);
+            }
+            stream.rewind();
+            uint64_t sum = 0;
+            for(size_t end : ends)
+            {
+                stream.release(end);
+                uint64_t start = benchTime();
+                gps.process();
+                sum += benchTime() - start;
+            }
+            total = std::min(total, sum);
+            skipped = gps.getSkippedFrames();
+        }
+        Serial.printf("filter %-3s %6.0f bytes/epoch %8.1f ns/epoch %5.2f ns/byte, %u frames skipped\n", 
+            filter ? "on" : "off", (double) stream.size() / epochs, (double) total / epochs, 
+            (double) total / stream.size(), skipped);
+    }
+    return (0);
+}
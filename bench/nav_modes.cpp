@@ -0,0 +1,97 @@
+// ubGPSTime
+// get utc time from u-blox gps module
+// designed for nixie clocks...
+// Version 0.1.3 (alpha)
+
+// MIT license
+// Copyright 2021 highvoltglow
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), to deal in the Software without restriction, 
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, 
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software 
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR 
+// OTHER DEALINGS IN THE SOFTWARE.
+
+// CPU time of process() per navigation update: NAV-TIMEUTC + NAV-STATUS against NAV-PVT
+// build: g++ -std=c++11 -O2 -I host -I . bench/nav_modes.cpp ubGPSTime.cpp host/Arduino.cpp -o nav_modes
+// usage: nav_modes [updates]
+
+#include "benchStream.h"
+#include <algorithm>
+
+#define BENCH_PASSES 5
+
+// subscription mode, status every n-th update (0: none), PVT replaces both
+typedef struct
+{
+    const char *name;
+    uint8_t statusRate;
+    bool pvt;
+}
+BENCHMODE;
+
+int main(int argc, char *argv[])
+{
+    uint32_t updates = argc > 1 ? atoi(argv[1]) : 100000;
+    const BENCHMODE modes[] = 
+    {
+        { "NAV-TIMEUTC (1 s) + NAV-STATUS (5 s)", 5, false },
+        { "NAV-TIMEUTC (1 s) + NAV-STATUS (1 s)", 1, false },
+        { "NAV-PVT (1 s)", 0, true }
+    };
+
+    for(const BENCHMODE &mode : modes)
+    {
+        BenchStream stream;
+        std::vector<size_t> ends;
+        for(uint32_t i = 0; i < updates; i++)
+        {
+            // one hour of epochs, repeated
+            uint32_t epoch = i % 3600;
+            if(mode.pvt)
+            {
+                stream.frame(UBX_NAV, UBX_NAV_PVT, benchPVT(epoch));
+            }
+            else
+            {
+                stream.frame(UBX_NAV, UBX_NAV_TIMEUTC, benchTimeUTC(epoch));
+                if(i % mode.statusRate == 0)
+                {
+                    stream.frame(UBX_NAV, UBX_NAV_STATUS, benchStatus(epoch));
+                }
+            }
+            ends.push_back(stream.size());
+        }
+
+        // best of several passes, the host is not idle
+        uint64_t total = UINT64_MAX;
+        for(uint8_t pass = 0; pass < BENCH_PASSES; pass++)
+        {
+            ubGPSTime gps;
+            gps.begin(stream);
+            stream.rewind();
+            uint64_t sum = 0;
+            for(size_t end : ends)
+            {
+                stream.release(end);
+                uint64_t start = benchTime();
+                gps.process();
+                sum += benchTime() - start;
+            }
+            total = std::min(total, sum);
+        }
+        Serial.printf("%-38s %6.1f bytes/update %7.1f ns/update %5.2f ns/byte\n", mode.name,
+            (double) stream.size() / updates, (double) total / updates, (double) total / stream.size());
+    }
+    return (0);
+}
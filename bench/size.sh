@@ -0,0 +1,49 @@
+#!/bin/sh
+# code and RAM size of ubGPSTime per feature configuration
+# uses avr-g++/avr-size (ATmega328P) when installed, the host compiler otherwise
+# text/data/bss of ubGPSTime.cpp, instance is sizeof(ubGPSTime) (RAM of each object)
+# usage: sh bench/size.sh [extra compiler flags], run from the repository root
+
+if command -v avr-g++ > /dev/null && command -v avr-size > /dev/null
+then
+    CXX=${CXX:-avr-g++}
+    SIZE=${SIZE:-avr-size}
+    TARGET="-mmcu=${MCU:-atmega328p}"
+else
+    CXX=${CXX:-g++}
+    SIZE=${SIZE:-size}
+    TARGET=""
+fi
+FLAGS="-std=gnu++11 -Os -ffunction-sections -fdata-sections -I host -I . $TARGET $*"
+FEATURES="VERBOSE MODULEVERSION CALLBACKS CHUNKED RECOVERY TIMING SECOND NAV_STATUS NAV_TIMEUTC NAV_PVT"
+BUILD=_test_build/size
+mkdir -p $BUILD
+
+# instance size as a bss object, works for cross compilers that cannot run the result
+echo '#include <ubGPSTime.h>' > $BUILD/instance.cpp
+echo 'unsigned char ubGPSTimeInstance[sizeof(ubGPSTime)];' >> $BUILD/instance.cpp
+
+report()
+{
+    if ! $CXX $FLAGS $2 -c ubGPSTime.cpp -o $BUILD/ubGPSTime.o || 
+        ! $CXX $FLAGS $2 -c $BUILD/instance.cpp -o $BUILD/instance.o
+    then
+        echo "$1: build failed"
+        return 1
+    fi
+    set -- "$1" $($SIZE $BUILD/ubGPSTime.o | tail -1) $($SIZE $BUILD/instance.o | tail -1)
+    printf "%-24s %8s %8s %8s %9s\n" "$1" $2 $3 $4 ${10}
+}
+
+echo "$CXX $FLAGS"
+printf "%-24s %8s %8s %8s %9s\n" configuration text data bss instance
+failed=0
+report "all features" "" || failed=1
+none=""
+for f in $FEATURES
+do
+    report "UBGPS_$f=0" "-DUBGPS_$f=0" || failed=1
+    none="$none -DUBGPS_$f=0"
+done
+report "all features off" "$none" || failed=1
+exit $failed
@@ -0,0 +1,263 @@
+// ubGPSTime
+// get utc time from u-blox gps module
+// designed for nixie clocks...
+// Version 0.1.3 (alpha)
+
+// MIT license
+// Copyright 2021 highvoltglow
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), to deal in the Software without restriction, 
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, 
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software 
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR 
+// OTHER DEALINGS IN THE SOFTWARE.
+
+// libFuzzer harness for the UBX parser and all message handlers (Linux host builds)
+// the first input byte selects the library options, the second how far the clock moves per process() call
+// (10 ms units, timeouts, reset detection and recovery become reachable), the rest is received in slices
+// libFuzzer:  clang++ -std=c++11 -g -O1 -fsanitize=fuzzer,address,undefined -I host -I . 
+//             fuzz/ubx_fuzz.cpp ubGPSTime.cpp host/Arduino.cpp -o ubx_fuzz
+//             ./ubx_fuzz -max_len=70000 fuzz/corpus
+// replay/AFL: g++ -std=c++11 -g -O1 -fsanitize=address,undefined -DUBX_FUZZ_MAIN -I host -I . 
+//             fuzz/ubx_fuzz.cpp ubGPSTime.cpp host/Arduino.cpp -o ubx_replay
+//             ./ubx_replay fuzz/corpus/* (without arguments the input is read from stdin)
+
+#include <Arduino.h>
+#include <ubGPSTime.h>
+#include <stdio.h>
+#include <time.h>
+#include <vector>
+
+// fuzz options, first input byte
+const uint8_t FUZZ_FILTER = 0x01;
+const uint8_t FUZZ_CHUNKED = 0x02;
+const uint8_t FUZZ_RECOVERY = 0x04;
+const uint8_t FUZZ_TXQUEUE = 0x08;
+const uint8_t FUZZ_VERBOSE = 0x10;
+const uint8_t FUZZ_POLLS = 0x20;
+const uint8_t FUZZ_SLICE = 0xC0; // 1, 7, 64 or all bytes per process() call
+const uint32_t FUZZ_CLOCK_STEP = 10000; // us per unit of the second input byte
+
+// input bytes as serial port, written bytes are discarded
+class FuzzStream : public Stream
+{
+public:
+    FuzzStream(const uint8_t *data, size_t size) : _data(data), _size(size), _pos(0), _limit(0) {}
+
+    // makes the next bytes available
+    void release(size_t count)
+    {
+        _limit = _size - _limit < count ? _size : _limit + count;
+    }
+
+    bool done()
+    {
+        return (_pos == _size);
+    }
+
+    int available() override { return ((int)(_limit - _pos)); }
+    int read() override { return (_pos < _limit ? _data[_pos++] : -1); }
+    int peek() override { return (_pos < _limit ? _data[_pos] : -1); }
+    size_t write(uint8_t) override { return (1); }
+    size_t write(const uint8_t *, size_t size) override { return (size); }
+    int availableForWrite() override { return (64); }
+
+private:
+    const uint8_t *_data;
+    size_t _size;
+    size_t _pos;
+    size_t _limit;
+};
+
+// debug output sink, keeps the verbose printing paths covered
+class NullStream : public Stream
+{
+public:
+    int available() override { return (0); }
+    int read() override { return (-1); }
+    int peek() override { return (-1); }
+    size_t write(uint8_t) override { return (1); }
+    size_t write(const uint8_t *, size_t size) override { return (size); }
+};
+
+static ubGPSTime *fuzzGPS = nullptr;
+static volatile uint32_t fuzzSink = 0;
+
+// reads everything the handlers decoded
+static void onMessage(UBXMESSAGE *message)
+{
+    TIMEUTC time = fuzzGPS->getTimeUTC();
+    GPSSTATUS status = fuzzGPS->getGPSStatus();
+    fuzzSink += message->payloadLength + time.second + status.gpsFixType;
+#if UBGPS_MODULEVERSION
+    fuzzSink += (uint8_t) fuzzGPS->getModuleVersion().swVersion[0];
+#endif
+}
+
+static bool onChunk(chunkEvent, PAYLOADCHUNK *chunk, void *)
+{
+    for(uint16_t i = 0; i < chunk->length; i++)
+    {
+        fuzzSink += chunk->data[i];
+    }
+    return (true);
+}
+
+static void onTick(TIMEUTC *time)
+{
+    fuzzSink += time->second;
+}
+
+static void onPoll(uint8_t msgClass, uint8_t msgID, UBXMESSAGE *, void *)
+{
+    fuzzSink += msgClass + msgID;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    if(size < 2)
+    {
+        return (0);
+    }
+    const uint8_t options = data[0];
+    const uint32_t clockStep = data[1] * FUZZ_CLOCK_STEP;
+    const size_t slices[4] = { 1, 7, 64, size };
+    FuzzStream input(data + 2, size - 2);
+    NullStream debug;
+    ubGPSTime gps;
+
+    fuzzGPS = &gps;
+    gps.begin(input);
+#if UBGPS_CALLBACKS
+    gps.attach(onMessage);
+#endif
+#if UBGPS_VERBOSE
+    if(options & FUZZ_VERBOSE)
+    {
+        gps.enableVerbose(debug);
+    }
+#endif
+    if(options & FUZZ_FILTER)
+    {
+        gps.enableFilter();
+        gps.acceptClass(UBX_NAV);
+        gps.acceptMessage(UBX_MON, UBX_MON_VER);
+    }
+#if UBGPS_CHUNKED
+    if(options & FUZZ_CHUNKED)
+    {
+        gps.attachChunked(onChunk);
+    }
+#endif
+#if UBGPS_RECOVERY
+    if(options & FUZZ_RECOVERY)
+    {
+        // configuration to restore: NMEA off, NMEA in the input looks like a reset after RESET_GUARD
+        gps.enableRecovery();
+        gps.setMessageRate(UBX_NMEA, UBX_NMEA_GGA, 0, onPoll);
+        gps.setMessageRate(UBX_NAV, UBX_NAV_TIMEUTC, 1, onPoll);
+    }
+    else
+    {
+        gps.disableRecovery();
+    }
+#endif
+#if UBGPS_SECOND
+    gps.onSecond(onTick);
+#endif
+    if(options & FUZZ_TXQUEUE)
+    {
+        gps.enableTxQueue(32);
+    }
+    if(options & FUZZ_POLLS)
+    {
+        // pending requests are completed by ACK/NACK and answers in the input
+        gps.poll(UBX_NAV, UBX_NAV_TIMEUTC, onPoll);
+        gps.poll(UBX_MON, UBX_MON_VER, onPoll);
+        gps.setMessageRate(UBX_NAV, UBX_NAV_STATUS, 1, onPoll);
+        gps.setMessageRate(UBX_NAV, UBX_NAV_PVT, 1, onPoll);
+    }
+
+    size_t slice = slices[options >> 6];
+    while(!input.done())
+    {
+        input.release(slice);
+        gps.process();
+        advanceClock(clockStep);
+    }
+    gps.process();
+
+#if UBGPS_TIMING
+    const TIMINGSTATS &stats = gps.getTimingStats();
+    fuzzSink += stats.samples + (uint32_t) gps.getAllanDeviation(1);
+#endif
+    fuzzGPS = nullptr;
+    return (0);
+}
+
+#ifdef UBX_FUZZ_MAIN
+static uint64_t wallClock()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec);
+}
+
+static std::vector<uint8_t> readInput(FILE *file)
+{
+    std::vector<uint8_t> data;
+    int c;
+    while((c = fgetc(file)) != EOF)
+    {
+        data.push_back((uint8_t) c);
+    }
+    return (data);
+}
+
+// runs stdin once (AFL), or replays the files for a second and reports the executions per second
+int main(int argc, char *argv[])
+{
+    if(argc < 2)
+    {
+        std::vector<uint8_t> data = readInput(stdin);
+        return (LLVMFuzzerTestOneInput(data.data(), data.size()));
+    }
+    std::vector<std::vector<uint8_t>> inputs;
+    for(int i = 1; i < argc; i++)
+    {
+        FILE *file = fopen(argv[i], "rb");
+        if(!file)
+        {
+            printf("Failed to open %s\n", argv[i]);
+            return (1);
+        }
+        inputs.push_back(readInput(file));
+        fclose(file);
+    }
+    // wall clock, millis() is moved forward by the inputs
+    uint32_t runs = 0;
+    uint64_t start = wallClock();
+    do
+    {
+        for(const std::vector<uint8_t> &data : inputs)
+        {
+            LLVMFuzzerTestOneInput(data.data(), data.size());
+            runs++;
+        }
+    }
+    while(wallClock() - start < 1000000000ULL);
+    printf("%u inputs, %u execs/s\n", (unsigned) inputs.size(), 
+        (unsigned)(runs * 1000000000ULL / (wallClock() - start)));
+    return (0);
+}
+#endif
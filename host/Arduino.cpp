@@ -0,0 +1,141 @@
+// ubGPSTime
+// get utc time from u-blox gps module
+// designed for nixie clocks...
+// Version 0.1.3 (alpha)
+
+// MIT license
+// Copyright 2021 highvoltglow
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), to deal in the Software without restriction, 
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, 
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software 
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR 
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#include <Arduino.h>
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
+
+HardwareSerial Serial;
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+    size_t n = 0;
+    while(size--)
+    {
+        n += write(*buffer++);
+    }
+    return (n);
+}
+
+size_t Print::print(const char *s)
+{
+    return (write((const uint8_t *) s, strlen(s)));
+}
+
+size_t Print::print(char c)
+{
+    return (write((uint8_t) c));
+}
+
+size_t Print::print(long value, int base)
+{
+    if((base == DEC) && (value < 0))
+    {
+        return (print('-') + print((unsigned long) -value, base));
+    }
+    return (print((unsigned long) value, base));
+}
+
+size_t Print::print(unsigned long value, int base)
+{
+    char buffer[8 * sizeof(long) + 1];
+    char *s = &buffer[sizeof(buffer) - 1];
+    *s = 0;
+    do
+    {
+        uint8_t digit = value % base;
+        *--s = digit < 10 ? '0' + digit : 'A' + digit - 10;
+        value /= base;
+    }
+    while(value);
+    return (print(s));
+}
+
+size_t Print::print(double value, int digits)
+{
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+    return (print(buffer));
+}
+
+size_t Print::printf(const char *format, ...)
+{
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if(n < 0)
+    {
+        return (0);
+    }
+    return (write((const uint8_t *) buffer, strlen(buffer)));
+}
+
+size_t HardwareSerial::write(uint8_t value)
+{
+    return (fwrite(&value, 1, 1, stdout));
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+    return (fwrite(buffer, 1, size, stdout));
+}
+
+void HardwareSerial::flush()
+{
+    fflush(stdout);
+}
+
+// monotonic clock, wraps like on the target
+// us since boot plus the offset added by advanceClock()
+static uint64_t clockOffset = 0;
+
+static uint64_t clockMicros()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec * 1000000ULL + now.tv_nsec / 1000 + clockOffset);
+}
+
+unsigned long micros()
+{
+    return ((unsigned long)(uint32_t) clockMicros());
+}
+
+unsigned long millis()
+{
+    return ((unsigned long)(uint32_t)(clockMicros() / 1000));
+}
+
+void advanceClock(unsigned long us)
+{
+    clockOffset += us;
+}
+
+void delay(unsigned long ms)
+{
+    usleep(ms * 1000);
+}
@@ -0,0 +1,102 @@
+// ubGPSTime
+// get utc time from u-blox gps module
+// designed for nixie clocks...
+// Version 0.1.3 (alpha)
+
+// MIT license
+// Copyright 2021 highvoltglow
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), to deal in the Software without restriction, 
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, 
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software 
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR 
+// OTHER DEALINGS IN THE SOFTWARE.
+
+// minimal Arduino API for Linux host builds of the library, the examples and the tests
+// Print/Stream, Serial on stdout, millis(), micros() and delay()
+// add this directory to the include path: g++ -I host -I . ... host/Arduino.cpp
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define DEC 10
+#define HEX 16
+#define F(s) (s)
+
+class Print
+{
+public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t value) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    virtual int availableForWrite() { return (0); }
+    virtual void flush() {}
+
+    size_t print(const char *s);
+    size_t print(char c);
+    size_t print(long value, int base = DEC);
+    size_t print(unsigned long value, int base = DEC);
+    size_t print(int value, int base = DEC) { return (print((long) value, base)); }
+    size_t print(unsigned int value, int base = DEC) { return (print((unsigned long) value, base)); }
+    size_t print(unsigned char value, int base = DEC) { return (print((unsigned long) value, base)); }
+    size_t print(bool value) { return (print((unsigned long) value)); }
+    size_t print(double value, int digits = 2);
+
+    size_t println() { return (print("\r\n")); }
+    template<typename T>
+    size_t println(T value) { size_t n = print(value); return (n + println()); }
+    template<typename T>
+    size_t println(T value, int format) { size_t n = print(value, format); return (n + println()); }
+
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+};
+
+// standard output, input is not used
+class HardwareSerial : public Stream
+{
+public:
+    void begin(unsigned long) {}
+    size_t write(uint8_t value) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    int availableForWrite() override { return (4096); }
+    void flush() override;
+    int available() override { return (0); }
+    int read() override { return (-1); }
+    int peek() override { return (-1); }
+};
+
+extern HardwareSerial Serial;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+// host builds only: moves millis() and micros() forward, tests and the fuzzer reach timeouts without waiting
+void advanceClock(unsigned long us);
+
+#endif
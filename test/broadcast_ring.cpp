@@ -0,0 +1,95 @@
+// ubGPSTime
+// get utc time from u-blox gps module
+// designed for nixie clocks...
+// Version 0.1.3 (alpha)
+
+// MIT license
+// Copyright 2021 highvoltglow
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), to deal in the Software without restriction, 
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, 
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software 
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR 
+// OTHER DEALINGS IN THE SOFTWARE.
+
+// broadcast ring: subscribers reject truncated or foreign rings and receive published entries
+
+#include "ubxSimulator.h"
+#include <ubGPSTimeBroadcast.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#define TEST_NAME "/ubgpstime_test"
+#define TEST_SOCKET "/tmp/ubgpstime_test.sock"
+
+int main()
+{
+    ubGPSTimePublisher publisher;
+    ubGPSTimeSubscriber subscriber;
+
+    // truncated object, mapping it would raise SIGBUS on access
+    int fd = shm_open(TEST_NAME, O_CREAT | O_RDWR, 0644);
+    CHECK(fd >= 0);
+    CHECK(ftruncate(fd, 16) == 0);
+    CHECK(!subscriber.open(TEST_NAME, TEST_SOCKET));
+
+    // ring of a publisher built with another slot size
+    CHECK(ftruncate(fd, sizeof(BROADCASTRING)) == 0);
+    BROADCASTRING *ring = (BROADCASTRING *) mmap(nullptr, sizeof(BROADCASTRING), 
+        PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    CHECK(ring != MAP_FAILED);
+    ring->magic = BROADCAST_MAGIC;
+    ring->version = BROADCAST_VERSION;
+    ring->slots = BROADCAST_SLOTS;
+    ring->slotSize = BROADCAST_SLOT_SIZE / 2;
+    CHECK(!subscriber.open(TEST_NAME, TEST_SOCKET));
+    ring->slotSize = BROADCAST_SLOT_SIZE;
+    ring->slots = BROADCAST_SLOTS * 2;
+    CHECK(!subscriber.open(TEST_NAME, TEST_SOCKET));
+    munmap(ring, sizeof(BROADCASTRING));
+    ::close(fd);
+    shm_unlink(TEST_NAME);
+
+    // matching ring
+    CHECK(publisher.open(TEST_NAME, TEST_SOCKET));
+    CHECK(subscriber.open(TEST_NAME, TEST_SOCKET));
+    uint32_t start = millis();
+    while((publisher.getStats().subscribers == 0) && (millis() - start < 1000))
+    {
+        publisher.process();
+    }
+    CHECK(publisher.getStats().subscribers == 1);
+
+    TIMEUTC time = {};
+    for(uint32_t i = 1; i <= 3; i++)
+    {
+        time.timeOfWeek = i;
+        publisher.publishTimeUTC(time);
+    }
+    uint32_t received = 0;
+    while(subscriber.wait(100))
+    {
+        const BROADCASTSLOT *slot = subscriber.peek();
+        CHECK(slot && (slot->type == BROADCAST_TIMEUTC) && (slot->length == sizeof(TIMEUTC)));
+        CHECK(slot && (((const TIMEUTC *) slot->data)->timeOfWeek == received + 1));
+        CHECK(subscriber.consume());
+        received++;
+    }
+    CHECK(received == 3);
+    CHECK(subscriber.getLost() == 0);
+
+    subscriber.close();
+    publisher.close();
+    printf("broadcast_ring: %s\n", testFailures ? "FAILED" : "ok");
+    return (testFailures ? 1 : 0);
+}
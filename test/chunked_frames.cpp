@@ -0,0 +1,210 @@
+// ubGPSTime
+// get utc time from u-blox gps module
+// designed for nixie clocks...
+// Version 0.1.3 (alpha)
+
+// MIT license
+// Copyright 2021 highvoltglow
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), to deal in the Software without restriction, 
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, 
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software 
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR 
+// OTHER DEALINGS IN THE SOFTWARE.
+
+// chunked delivery of payloads larger than MAX_PAYLOAD, up to the 65535 bytes a UBX length allows
+
+#include "ubxSimulator.h"
+
+#define TEST_CLASS 0x02 // RXM
+#define TEST_ID 0x15
+
+ubxSimulator receiver;
+ubGPSLinuxSerial gpsCom;
+ubGPSTime gps;
+
+// chunk sequence of one frame
+typedef struct
+{
+    uint32_t begins;
+    uint32_t ends;
+    uint32_t received; // payload bytes
+    uint16_t payloadLength;
+    bool ordered; // offsets contiguous, chunks within CHUNK_SIZE
+    bool content; // data matches the pattern
+    bool valid;
+}
+CHUNKRESULT;
+
+CHUNKRESULT result;
+uint32_t timeMessages = 0;
+
+uint8_t pattern(uint32_t index)
+{
+    return ((uint8_t)(index * 7 + (index >> 8)));
+}
+
+bool onChunk(chunkEvent event, PAYLOADCHUNK *chunk, void *context)
+{
+    CHUNKRESULT *r = (CHUNKRESULT *) context;
+    switch(event)
+    {
+        case chunkEvent::begin:
+            r->begins++;
+            r->payloadLength = chunk->payloadLength;
+            break;
+
+        case chunkEvent::data:
+            if((chunk->offset != r->received) || (chunk->length == 0) || (chunk->length > CHUNK_SIZE))
+            {
+                r->ordered = false;
+            }
+            for(uint16_t i = 0; i < chunk->length; i++)
+            {
+                if(chunk->data[i] != pattern(chunk->offset + i))
+                {
+                    r->content = false;
+                }
+            }
+            r->received += chunk->length;
+            break;
+
+        case chunkEvent::end:
+            r->ends++;
+            r->valid = chunk->valid;
+            break;
+    }
+    return (true);
+}
+
+// poll answered by a chunked frame
+uint32_t pollResponses = 0;
+uint32_t pollTimeouts = 0;
+
+void onPoll(uint8_t, uint8_t, UBXMESSAGE *message, void *)
+{
+    if(message)
+    {
+        CHECK((message->msgClass == TEST_CLASS) && (message->msgID == TEST_ID));
+        CHECK((message->payloadLength == 0) && (message->payload == nullptr));
+        pollResponses++;
+    }
+    else
+    {
+        pollTimeouts++;
+    }
+}
+
+void onGPSMessage(UBXMESSAGE *message)
+{
+    if((message->msgClass == UBX_NAV) && (message->msgID == UBX_NAV_TIMEUTC))
+    {
+        timeMessages++;
+    }
+}
+
+// sends a large frame followed by NAV-TIMEUTC, the parser has to be back in sync afterwards
+bool transfer(uint16_t length)
+{
+    std::vector<uint8_t> payload(length);
+    for(uint32_t i = 0; i < length; i++)
+    {
+        payload[i] = pattern(i);
+    }
+    uint32_t expected = timeMessages + 1;
+    // the pseudo-terminal buffer is smaller than the frame, write while process() reads
+    std::thread sender([&]()
+    {
+        receiver.sendFrame(TEST_CLASS, TEST_ID, payload.data(), length);
+        receiver.sendTimeUTC();
+    });
+    uint32_t start = millis();
+    while((timeMessages < expected) && (millis() - start < 5000))
+    {
+        if(gpsCom.waitForData(10))
+        {
+            gps.process();
+        }
+    }
+    sender.join();
+    return (timeMessages == expected);
+}
+
+int main()
+{
+    char slaveName[64];
+
+    CHECK(receiver.start(slaveName, sizeof(slaveName)));
+    CHECK(gpsCom.open(slaveName, 115200));
+    receiver.setEpoch(3600000); // no periodic messages
+    gps.begin(gpsCom, 115200);
+    gps.attach(onGPSMessage);
+
+    // without a chunk handler large frames are dismissed, the parser resyncs on the next header
+    CHECK(transfer(65535));
+    CHECK(gps.getSkippedFrames() == 1);
+
+    // a corrupted header with a huge length must not swallow the frames behind it
+    const uint8_t bogus[] = { UBX_HEADER1, UBX_HEADER2, UBX_NAV, UBX_NAV_TIMEUTC, 0xF0, 0xE0 };
+    uint32_t expected = timeMessages + 10;
+    receiver.sendRaw(bogus, sizeof(bogus));
+    for(uint8_t i = 0; i < 10; i++)
+    {
+        receiver.sendTimeUTC();
+    }
+    uint32_t start = millis();
+    while((timeMessages < expected) && (millis() - start < 2000))
+    {
+        if(gpsCom.waitForData(10))
+        {
+            gps.process();
+        }
+    }
+    CHECK(timeMessages == expected);
+    CHECK(gps.getSkippedFrames() == 2);
+
+    gps.attachChunked(onChunk, &result);
+    const uint16_t lengths[] = { MAX_PAYLOAD + 1, 2048, 65535 };
+    for(uint16_t length : lengths)
+    {
+        result = CHUNKRESULT();
+        result.ordered = true;
+        result.content = true;
+        CHECK(transfer(length));
+        CHECK((result.begins == 1) && (result.ends == 1));
+        CHECK(result.payloadLength == length);
+        CHECK(result.received == length);
+        CHECK(result.ordered);
+        CHECK(result.content);
+        CHECK(result.valid);
+    }
+
+    // a poll for a large message completes at the end event
+    CHECK(gps.poll(TEST_CLASS, TEST_ID, onPoll, nullptr, 5000));
+    result = CHUNKRESULT();
+    CHECK(transfer(2048));
+    CHECK(result.valid);
+    CHECK((pollResponses == 1) && (pollTimeouts == 0));
+    CHECK(gps.getPendingPolls() == 0);
+
+    // payloads within MAX_PAYLOAD are not chunked
+    result = CHUNKRESULT();
+    CHECK(transfer(MAX_PAYLOAD));
+    CHECK(result.begins == 0);
+    CHECK(gps.getSkippedFrames() == 2);
+
+    receiver.stop();
+    gpsCom.close();
+    printf("chunked_frames: %s\n", testFailures ? "FAILED" : "ok");
+    return (testFailures ? 1 : 0);
+}
@@ -0,0 +1,99 @@
+// ubGPSTime
+// get utc time from u-blox gps module
+// designed for nixie clocks...
+// Version 0.1.3 (alpha)
+
+// MIT license
+// Copyright 2021 highvoltglow
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), to deal in the Software without restriction, 
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, 
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software 
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR 
+// OTHER DEALINGS IN THE SOFTWARE.
+
+// poll scheduler: the receiver ignores every third request
+// every callback fires exactly once, dropped requests time out, the table drains
+
+#include "ubxSimulator.h"
+
+#define TEST_POLLS 48
+
+ubxSimulator receiver;
+ubGPSLinuxSerial gpsCom;
+ubGPSTime gps;
+uint8_t fired[TEST_POLLS];
+uint32_t responses = 0;
+uint32_t timeouts = 0;
+
+void onPoll(uint8_t msgClass, uint8_t msgID, UBXMESSAGE *message, void *context)
+{
+    uint8_t *counter = (uint8_t *) context;
+    (*counter)++;
+    if(message)
+    {
+        CHECK((message->msgClass == msgClass) && (message->msgID == msgID));
+        responses++;
+    }
+    else
+    {
+        timeouts++;
+    }
+}
+
+int main()
+{
+    char slaveName[64];
+    const uint8_t ids[3] = { UBX_NAV_TIMEUTC, UBX_NAV_STATUS, UBX_MON_VER };
+
+    CHECK(receiver.start(slaveName, sizeof(slaveName)));
+    CHECK(gpsCom.open(slaveName, 115200));
+    receiver.setDropEvery(3);
+    gps.begin(gpsCom, 115200);
+
+    uint32_t issued = 0;
+    uint32_t start = millis();
+    while(((issued < TEST_POLLS) || gps.getPendingPolls()) && (millis() - start < 20000))
+    {
+        // keep the table full
+        while(issued < TEST_POLLS)
+        {
+            uint8_t id = ids[issued % 3];
+            uint8_t msgClass = id == UBX_MON_VER ? UBX_MON : UBX_NAV;
+            if(!gps.poll(msgClass, id, onPoll, &fired[issued], 200))
+            {
+                break;
+            }
+            issued++;
+        }
+        gpsCom.waitForData(10);
+        gps.process();
+    }
+
+    CHECK(issued == TEST_POLLS);
+    CHECK(gps.getPendingPolls() == 0);
+    for(uint32_t i = 0; i < TEST_POLLS; i++)
+    {
+        CHECK(fired[i] == 1);
+    }
+    CHECK(responses + timeouts == TEST_POLLS);
+    // requests for the same message share one poll on the wire, a dropped poll times out all of them
+    CHECK(receiver.getRequests() <= TEST_POLLS);
+    CHECK(receiver.getDropped() > 0);
+    CHECK(timeouts >= receiver.getDropped());
+
+    receiver.stop();
+    gpsCom.close();
+    printf("poll_drops: %u responses, %u timeouts, %s\n", responses, timeouts, testFailures ? "FAILED" : "ok");
+    return (testFailures ? 1 : 0);
+}
@@ -0,0 +1,80 @@
+// ubGPSTime
+// get utc time from u-blox gps module
+// designed for nixie clocks...
+// Version 0.1.3 (alpha)
+
+// MIT license
+// Copyright 2021 highvoltglow
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), to deal in the Software without restriction, 
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, 
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software 
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR 
+// OTHER DEALINGS IN THE SOFTWARE.
+
+// smoke test: initialize and subscribe through a pseudo-terminal, receive NAV-TIMEUTC
+
+#include "ubxSimulator.h"
+
+ubxSimulator receiver;
+ubGPSLinuxSerial gpsCom;
+ubGPSTime gps;
+uint32_t timeMessages = 0;
+
+void onGPSMessage(UBXMESSAGE *message)
+{
+    if((message->msgClass == UBX_NAV) && (message->msgID == UBX_NAV_TIMEUTC))
+    {
+        timeMessages++;
+    }
+}
+
+int main()
+{
+    char slaveName[64];
+
+    CHECK(receiver.start(slaveName, sizeof(slaveName)));
+    CHECK(gpsCom.open(slaveName, 115200));
+    receiver.setEpoch(100);
+
+    gps.begin(gpsCom, 115200);
+    gps.initialize();
+    CHECK(gps.isInitialized());
+#if UBGPS_MODULEVERSION
+    CHECK(strcmp(gps.getModuleVersion().hwVersion, "00080000") == 0);
+#endif
+    // default NMEA disabled and acknowledged
+    CHECK(gps.getPendingPolls() == 0);
+    CHECK(receiver.getRate(UBX_NMEA, UBX_NMEA_GGA) == 0);
+
+    gps.attach(onGPSMessage);
+    gps.subscribeTimeUTC(1);
+    CHECK(receiver.getRate(UBX_NAV, UBX_NAV_TIMEUTC) == 1);
+
+    uint32_t start = millis();
+    while((timeMessages < 5) && (millis() - start < 3000))
+    {
+        if(gpsCom.waitForData(100))
+        {
+            gps.process();
+        }
+    }
+    CHECK(timeMessages >= 5);
+    CHECK(gps.getTimeUTC().year == 2024);
+    CHECK(gps.getTimeUTC().utcValid);
+
+    receiver.stop();
+    gpsCom.close();
+    printf("pty_smoke: %s\n", testFailures ? "FAILED" : "ok");
+    return (testFailures ? 1 : 0);
+}
@@ -0,0 +1,106 @@
+// ubGPSTime
+// get utc time from u-blox gps module
+// designed for nixie clocks...
+// Version 0.1.3 (alpha)
+
+// MIT license
+// Copyright 2021 highvoltglow
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), to deal in the Software without restriction, 
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, 
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software 
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR 
+// OTHER DEALINGS IN THE SOFTWARE.
+
+// receiver reset detection and recovery through the simulated receiver
+// NMEA banner after a power cycle, then a reboot that only stops the NAV messages
+
+#include "ubxSimulator.h"
+
+ubxSimulator receiver;
+ubGPSLinuxSerial gpsCom;
+ubGPSTime gps;
+uint32_t timeMessages = 0;
+
+void onGPSMessage(UBXMESSAGE *message)
+{
+    if((message->msgClass == UBX_NAV) && (message->msgID == UBX_NAV_TIMEUTC))
+    {
+        timeMessages++;
+    }
+}
+
+// processes until done() or timeout
+template <typename T>
+bool processUntil(uint32_t timeout, T done)
+{
+    uint32_t start = millis();
+    while(!done() && (millis() - start < timeout))
+    {
+        gpsCom.waitForData(10);
+        gps.process();
+    }
+    return (done());
+}
+
+// reset handled and configuration back on the receiver
+bool recovered(uint32_t resets)
+{
+    return ((gps.getRecoveryStats().resets == resets) && !gps.getRecoveryStats().recovering);
+}
+
+int main()
+{
+    char slaveName[64];
+
+    CHECK(receiver.start(slaveName, sizeof(slaveName)));
+    CHECK(gpsCom.open(slaveName, 115200));
+    receiver.setEpoch(250);
+    receiver.reboot(true);
+    gps.begin(gpsCom, 115200);
+    gps.initialize();
+    CHECK(gps.isInitialized());
+    gps.attach(onGPSMessage);
+    gps.subscribeTimeUTC(1);
+    CHECK(receiver.getRate(UBX_NMEA, UBX_NMEA_GGA) == 0);
+    CHECK(receiver.getRate(UBX_NAV, UBX_NAV_TIMEUTC) == 1);
+
+    // steady state past the guard time, no false detection
+    processUntil(RESET_GUARD + 1000, []() { return (false); });
+    CHECK(gps.getRecoveryStats().resets == 0);
+    CHECK(timeMessages > 0);
+
+    // power cycle with default NMEA output
+    receiver.reboot(true);
+    CHECK(processUntil(5000, []() { return (recovered(1)); }));
+    CHECK(gps.getRecoveryStats().resetJunkBytes > 0);
+    CHECK(receiver.getRate(UBX_NMEA, UBX_NMEA_GGA) == 0);
+    CHECK(receiver.getRate(UBX_NMEA, UBX_NMEA_RMC) == 0);
+    CHECK(receiver.getRate(UBX_NAV, UBX_NAV_TIMEUTC) == 1);
+    uint32_t before = timeMessages;
+    CHECK(processUntil(2000, [before]() { return (timeMessages > before); }));
+
+    // reboot without NMEA (disabled in flash), only the missing NAV messages show it
+    processUntil(RESET_GUARD + 500, []() { return (false); });
+    CHECK(gps.getRecoveryStats().resets == 1);
+    receiver.reboot(false);
+    CHECK(processUntil(RESET_NAV_GAP * 1000 + RESET_GUARD + 3000, []() { return (recovered(2)); }));
+    CHECK(receiver.getRate(UBX_NAV, UBX_NAV_TIMEUTC) == 1);
+    before = timeMessages;
+    CHECK(processUntil(2000, [before]() { return (timeMessages > before); }));
+
+    receiver.stop();
+    gpsCom.close();
+    printf("reset_recovery: %u resets, %s\n", gps.getRecoveryStats().resets, testFailures ? "FAILED" : "ok");
+    return (testFailures ? 1 : 0);
+}
@@ -0,0 +1,24 @@
+#!/bin/sh
+# builds and runs the Linux host tests with sanitizers
+# usage: sh test/run.sh [test ...], run from the repository root
+
+CXX=${CXX:-g++}
+FLAGS="-std=c++11 -g -O1 -Wall -Wextra -fsanitize=address,undefined -fno-sanitize-recover=undefined"
+SOURCES="ubGPSTime.cpp ubGPSLinuxSerial.cpp ubGPSTimeSHM.cpp ubGPSTimeBroadcast.cpp host/Arduino.cpp"
+BUILD=_test_build
+TESTS=${*:-$(cd test && ls *.cpp | sed 's/\.cpp$//')}
+
+mkdir -p $BUILD
+failed=0
+for t in $TESTS
+do
+    if ! $CXX $FLAGS -I host -I . -I test test/$t.cpp $SOURCES -o $BUILD/$t -pthread -lrt
+    then
+        echo "$t: build failed"
+        failed=1
+    elif ! $BUILD/$t
+    then
+        failed=1
+    fi
+done
+exit $failed
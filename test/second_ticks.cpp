@@ -0,0 +1,104 @@
+// ubGPSTime
+// get utc time from u-blox gps module
+// designed for nixie clocks...
+// Version 0.1.3 (alpha)
+
+// MIT license
+// Copyright 2021 highvoltglow
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), to deal in the Software without restriction, 
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, 
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software 
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR 
+// OTHER DEALINGS IN THE SOFTWARE.
+
+// top of second callback with latency 0: the predicted boundary is the arrival time of the next
+// NAV-TIMEUTC, a message parsed just before the boundary fires must not lose the tick
+
+#include "ubxSimulator.h"
+
+#define TEST_MESSAGES 10
+
+ubxSimulator receiver;
+ubGPSLinuxSerial gpsCom;
+ubGPSTime gps;
+uint32_t timeMessages = 0;
+uint32_t ticks = 0;
+uint32_t firstLabel = 0;
+uint32_t lastLabel = 0;
+bool consecutive = true;
+
+void onGPSMessage(UBXMESSAGE *message)
+{
+    if((message->msgClass == UBX_NAV) && (message->msgID == UBX_NAV_TIMEUTC))
+    {
+        timeMessages++;
+    }
+}
+
+void onTick(TIMEUTC *time)
+{
+    uint32_t label = time->hour * 3600UL + time->minute * 60UL + time->second;
+    if(ticks && (label != lastLabel + 1))
+    {
+        printf("tick %u after %u\n", label, lastLabel);
+        consecutive = false;
+    }
+    if(!ticks)
+    {
+        firstLabel = label;
+    }
+    lastLabel = label;
+    ticks++;
+}
+
+int main()
+{
+    char slaveName[64];
+
+    CHECK(receiver.start(slaveName, sizeof(slaveName)));
+    CHECK(gpsCom.open(slaveName, 115200));
+    gps.begin(gpsCom, 115200);
+    gps.attach(onGPSMessage);
+    gps.onSecond(onTick, 0);
+    gps.subscribeTimeUTC(1, false);
+
+    // one NAV-TIMEUTC per second, the poll loop of the simulator adds about 1 ms of jitter
+    uint32_t start = millis();
+    while((timeMessages < TEST_MESSAGES) && (millis() - start < (TEST_MESSAGES + 3) * 1000UL))
+    {
+        gpsCom.waitForData(1);
+        gps.process();
+    }
+    // ticks of the last message, less than a second so no holdover tick is due
+    start = millis();
+    while(millis() - start < 200)
+    {
+        gpsCom.waitForData(1);
+        gps.process();
+    }
+
+    // every second from the first message to the last one fired exactly once
+    CHECK(timeMessages == TEST_MESSAGES);
+    CHECK(consecutive);
+    CHECK(ticks == TEST_MESSAGES);
+    CHECK(lastLabel - firstLabel == TEST_MESSAGES - 1);
+    CHECK(gps.getSecondStats().missed == 0);
+    CHECK(gps.getSecondStats().ticks == ticks);
+
+    receiver.stop();
+    gpsCom.close();
+    printf("second_ticks: %u ticks for %u messages, max lateness %d us, %s\n", ticks, timeMessages, 
+        gps.getSecondStats().maxLateness, testFailures ? "FAILED" : "ok");
+    return (testFailures ? 1 : 0);
+}
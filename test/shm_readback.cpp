@@ -0,0 +1,87 @@
+// ubGPSTime
+// get utc time from u-blox gps module
+// designed for nixie clocks...
+// Version 0.1.3 (alpha)
+
+// MIT license
+// Copyright 2021 highvoltglow
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), to deal in the Software without restriction, 
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, 
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software 
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR 
+// OTHER DEALINGS IN THE SOFTWARE.
+
+// NTP shared memory refclock: samples read back the way chrony and ntpd read them
+
+#include "ubxSimulator.h"
+#include <ubGPSTimeSHM.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#define TEST_UNIT 200 // far from the units used by time servers
+
+int main()
+{
+    ubGPSTimeSHM refClock;
+    CHECK(refClock.open(TEST_UNIT));
+
+    int id = shmget(SHM_KEY_BASE + TEST_UNIT, sizeof(SHMTIME), 0);
+    CHECK(id >= 0);
+    const SHMTIME *shm = (const SHMTIME *) shmat(id, nullptr, SHM_RDONLY);
+    CHECK(shm != (const SHMTIME *) -1);
+    CHECK(shm->mode == 1);
+    CHECK(shm->valid == 0);
+
+    // 2024-01-01 12:00:00 minus 250 ns
+    TIMEUTC time = {};
+    time.year = 2024;
+    time.month = 1;
+    time.day = 1;
+    time.hour = 12;
+    time.nanoSecond = -250;
+    time.accuracy = 25;
+    time.utcValid = true;
+    time.rxTimestamp = micros();
+
+    // rejected samples do not touch the segment
+    time.utcValid = false;
+    CHECK(!refClock.update(time));
+    time.utcValid = true;
+    time.accuracy = SHM_MAX_ACCURACY + 1;
+    CHECK(!refClock.update(time));
+    time.accuracy = 25;
+    CHECK(shm->count == 0);
+    CHECK(refClock.getStats().rejected == 2);
+
+    CHECK(refClock.update(time));
+    CHECK(shm->valid == 1);
+    CHECK(shm->count == 2);
+    CHECK(shm->clockTimeStampSec == 1704110400 - 1);
+    CHECK(shm->clockTimeStampNSec == 999999750);
+    CHECK(shm->clockTimeStampUSec == 999999);
+    CHECK(shm->receiveTimeStampUSec == (int)(shm->receiveTimeStampNSec / 1000));
+    CHECK(shm->precision == SHM_PRECISION);
+    CHECK(shm->leap == 0);
+    CHECK(refClock.getStats().samples == 1);
+
+    CHECK(refClock.update(time));
+    CHECK(shm->count == 4);
+    CHECK(refClock.getStats().samples == 2);
+
+    shmdt(shm);
+    refClock.close();
+    shmctl(id, IPC_RMID, nullptr);
+    printf("shm_readback: %s\n", testFailures ? "FAILED" : "ok");
+    return (testFailures ? 1 : 0);
+}
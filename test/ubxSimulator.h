@@ -0,0 +1,322 @@
+// ubGPSTime
+// get utc time from u-blox gps module
+// designed for nixie clocks...
+// Version 0.1.3 (alpha)
+
+// MIT license
+// Copyright 2021 highvoltglow
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), to deal in the Software without restriction, 
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, 
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software 
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR 
+// OTHER DEALINGS IN THE SOFTWARE.
+
+// simulated u-blox receiver on the master side of a pseudo-terminal
+// answers MON-VER, NAV polls and CFG-MSG, sends subscribed NAV-TIMEUTC every epoch
+// runs in its own thread while the library blocks in initialize() or waitForResponse()
+
+#ifndef UBXSIMULATOR_H
+#define UBXSIMULATOR_H
+
+#include <Arduino.h>
+#include <ubGPSTime.h>
+#include <ubGPSLinuxSerial.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include <unistd.h>
+
+// test result, failures are counted and reported by main()
+static int testFailures = 0;
+#define CHECK(condition) \
+    do \
+    { \
+        if(!(condition)) \
+        { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            testFailures++; \
+        } \
+    } \
+    while(0)
+
+class ubxSimulator
+{
+public:
+    ~ubxSimulator()
+    {
+        stop();
+    }
+
+    // opens the pseudo-terminal and starts answering, slaveName is the device for ubGPSLinuxSerial
+    bool start(char *slaveName, size_t length)
+    {
+        _fd = ubGPSLinuxSerial::openPseudoTerminal(slaveName, length);
+        if(_fd < 0)
+        {
+            return (false);
+        }
+        _running = true;
+        _thread = std::thread(&ubxSimulator::run, this);
+        return (true);
+    }
+
+    void stop()
+    {
+        if(_running)
+        {
+            _running = false;
+            _thread.join();
+        }
+        if(_fd >= 0)
+        {
+            ::close(_fd);
+            _fd = -1;
+        }
+    }
+
+    // every n-th request is ignored, 0 answers all
+    void setDropEvery(uint32_t n)
+    {
+        _dropEvery = n;
+    }
+
+    // ms between navigation epochs
+    void setEpoch(uint32_t epoch)
+    {
+        _epoch = epoch;
+    }
+
+    uint32_t getRequests() { return (_requests); }
+    uint32_t getDropped() { return (_dropped); }
+    uint32_t getEpochs() { return (_epochs); }
+    uint8_t getRate(uint8_t msgClass, uint8_t msgID) { return (_rates[key(msgClass, msgID)]); }
+
+    // writes a frame with checksum, payloads up to 65535 bytes
+    void sendFrame(uint8_t msgClass, uint8_t msgID, const uint8_t *payload, uint16_t length)
+    {
+        std::vector<uint8_t> frame = { UBX_HEADER1, UBX_HEADER2, msgClass, msgID, 
+            (uint8_t)(length & 0xFF), (uint8_t)(length >> 8) };
+        frame.insert(frame.end(), payload, payload + length);
+        uint8_t a = 0;
+        uint8_t b = 0;
+        for(size_t i = 2; i < frame.size(); i++)
+        {
+            a += frame[i];
+            b += a;
+        }
+        frame.push_back(a);
+        frame.push_back(b);
+        sendRaw(frame.data(), frame.size());
+    }
+
+    // writes bytes as they are, e.g. a corrupted frame
+    void sendRaw(const uint8_t *data, size_t length)
+    {
+        std::lock_guard<std::mutex> lock(_writeLock);
+        size_t offset = 0;
+        while(offset < length)
+        {
+            ssize_t n = ::write(_fd, data + offset, length - offset);
+            if(n > 0)
+            {
+                offset += n;
+            }
+            else
+            {
+                struct pollfd fds = { _fd, POLLOUT, 0 };
+                ::poll(&fds, 1, 10);
+            }
+        }
+    }
+
+    // power cycle, message rates fall back to the defaults: default NMEA on (or off if stored in flash)
+    void reboot(bool nmea)
+    {
+        for(std::atomic<uint8_t> &rate : _rates)
+        {
+            rate = 0;
+        }
+        for(uint8_t id = UBX_NMEA_GGA; nmea && (id <= UBX_NMEA_VTG); id++)
+        {
+            _rates[key(UBX_NMEA, id)] = 1;
+        }
+    }
+
+    // writes an NMEA sentence, body without $ and checksum
+    void sendNMEA(const char *body)
+    {
+        uint8_t checksum = 0;
+        for(const char *c = body; *c; c++)
+        {
+            checksum ^= (uint8_t) *c;
+        }
+        char sentence[96];
+        int length = snprintf(sentence, sizeof(sentence), "$%s*%02X\r\n", body, checksum);
+        std::lock_guard<std::mutex> lock(_writeLock);
+        if(::write(_fd, sentence, length) != length)
+        {
+            return;
+        }
+    }
+
+    // NAV-TIMEUTC of the current epoch, 2024-01-01 12:00:00 + epochs
+    void sendTimeUTC()
+    {
+        uint8_t p[20] = {};
+        uint32_t seconds = _epochs * _epoch / 1000;
+        uint32_t tow = 216000000UL + _epochs * _epoch; // monday 12:00
+        put(p, 0, tow, 4);
+        put(p, 4, 25, 4); // accuracy ns
+        put(p, 8, 0, 4); // nanoseconds
+        put(p, 12, 2024, 2);
+        p[14] = 1;
+        p[15] = 1;
+        p[16] = 12 + seconds / 3600;
+        p[17] = (seconds / 60) % 60;
+        p[18] = seconds % 60;
+        p[19] = 0x07; // tow, week and UTC valid
+        sendFrame(UBX_NAV, UBX_NAV_TIMEUTC, p, sizeof(p));
+    }
+
+private:
+    int _fd = -1;
+    std::thread _thread;
+    std::atomic<bool> _running { false };
+    std::mutex _writeLock;
+    std::vector<uint8_t> _rx;
+    std::atomic<uint32_t> _requests { 0 };
+    std::atomic<uint32_t> _dropped { 0 };
+    std::atomic<uint32_t> _epochs { 0 };
+    std::atomic<uint32_t> _dropEvery { 0 };
+    std::atomic<uint32_t> _epoch { 1000 };
+    std::atomic<uint8_t> _rates[65536] = {};
+
+    static uint16_t key(uint8_t msgClass, uint8_t msgID)
+    {
+        return ((uint16_t)(msgClass << 8 | msgID));
+    }
+
+    static void put(uint8_t *p, uint16_t offset, uint32_t value, uint8_t size)
+    {
+        for(uint8_t i = 0; i < size; i++)
+        {
+            p[offset + i] = (uint8_t)(value >> (8 * i));
+        }
+    }
+
+    void run()
+    {
+        uint32_t epochTimestamp = millis();
+        while(_running)
+        {
+            struct pollfd fds = { _fd, POLLIN, 0 };
+            if(::poll(&fds, 1, 2) > 0)
+            {
+                uint8_t buffer[512];
+                ssize_t n = ::read(_fd, buffer, sizeof(buffer));
+                if(n > 0)
+                {
+                    _rx.insert(_rx.end(), buffer, buffer + n);
+                    parse();
+                }
+            }
+            if(millis() - epochTimestamp >= _epoch)
+            {
+                epochTimestamp += _epoch;
+                _epochs++;
+                if(_rates[key(UBX_NMEA, UBX_NMEA_GGA)])
+                {
+                    sendNMEA("GPGGA,120000.00,,,,,0,00,99.99,,,,,,");
+                }
+                if(_rates[key(UBX_NMEA, UBX_NMEA_RMC)])
+                {
+                    sendNMEA("GPRMC,120000.00,V,,,,,,,010124,,,N");
+                }
+                if(_rates[key(UBX_NAV, UBX_NAV_TIMEUTC)])
+                {
+                    sendTimeUTC();
+                }
+            }
+        }
+    }
+
+    // extracts complete request frames
+    void parse()
+    {
+        while(_rx.size() >= 8)
+        {
+            if((_rx[0] != UBX_HEADER1) || (_rx[1] != UBX_HEADER2))
+            {
+                _rx.erase(_rx.begin());
+                continue;
+            }
+            uint16_t length = _rx[4] | (_rx[5] << 8);
+            if(_rx.size() < (size_t) length + 8)
+            {
+                return;
+            }
+            std::vector<uint8_t> payload(_rx.begin() + 6, _rx.begin() + 6 + length);
+            uint8_t msgClass = _rx[2];
+            uint8_t msgID = _rx[3];
+            _rx.erase(_rx.begin(), _rx.begin() + length + 8);
+            request(msgClass, msgID, payload);
+        }
+    }
+
+    void request(uint8_t msgClass, uint8_t msgID, const std::vector<uint8_t> &payload)
+    {
+        _requests++;
+        if(_dropEvery && (_requests % _dropEvery == 0))
+        {
+            _dropped++;
+            return;
+        }
+        if((msgClass == UBX_CFG) && (msgID == UBX_CFG_MSG) && (payload.size() == 3))
+        {
+            _rates[key(payload[0], payload[1])] = payload[2];
+            uint8_t ack[2] = { UBX_CFG, UBX_CFG_MSG };
+            sendFrame(UBX_ACK, UBX_ACK_ACK, ack, sizeof(ack));
+        }
+        else if(!payload.empty())
+        {
+            return;
+        }
+        else if((msgClass == UBX_MON) && (msgID == UBX_MON_VER))
+        {
+            uint8_t p[40 + 3 * 30] = {};
+            strcpy((char *) &p[0], "ROM CORE 3.01 (107888)");
+            strcpy((char *) &p[30], "00080000");
+            strcpy((char *) &p[40], "PROTVER=18.00");
+            strcpy((char *) &p[70], "MOD=NEO-M8N");
+            strcpy((char *) &p[100], "GPS;GLO;GAL;BDS");
+            sendFrame(UBX_MON, UBX_MON_VER, p, sizeof(p));
+        }
+        else if((msgClass == UBX_NAV) && (msgID == UBX_NAV_TIMEUTC))
+        {
+            sendTimeUTC();
+        }
+        else if((msgClass == UBX_NAV) && (msgID == UBX_NAV_STATUS))
+        {
+            uint8_t p[16] = {};
+            put(p, 0, 216000000UL + _epochs * _epoch, 4);
+            p[4] = 3; // 3D fix
+            p[5] = 0x0D; // fix ok, tow and week valid
+            sendFrame(UBX_NAV, UBX_NAV_STATUS, p, sizeof(p));
+        }
+    }
+};
+
+#endif
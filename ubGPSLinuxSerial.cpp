@@ -0,0 +1,294 @@
+// ubGPSTime
+// get utc time from u-blox gps module
+// designed for nixie clocks...
+// Version 0.1.3 (alpha)
+
+// MIT license
+// Copyright 2021 highvoltglow
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), to deal in the Software without restriction, 
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, 
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software 
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR 
+// OTHER DEALINGS IN THE SOFTWARE.
+
+
+#if defined(__linux__)
+
+#include <ubGPSLinuxSerial.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/serial.h>
+
+// constructor
+ubGPSLinuxSerial::ubGPSLinuxSerial() :
+    _fd(-1), _rxPos(0), _rxLen(0), _wakeTimestamp(0)
+{
+}
+
+// destructor
+ubGPSLinuxSerial::~ubGPSLinuxSerial()
+{
+    close();
+}
+
+// maps a baud rate to the termios speed constant
+static speed_t toSpeed(uint32_t baudRate)
+{
+    switch(baudRate)
+    {
+        case 4800: return (B4800);
+        case 9600: return (B9600);
+        case 19200: return (B19200);
+        case 38400: return (B38400);
+        case 57600: return (B57600);
+        case 115200: return (B115200);
+        case 230400: return (B230400);
+        case 460800: return (B460800);
+        case 921600: return (B921600);
+        default: return (B0);
+    }
+}
+
+// opens the serial device in raw mode
+// reads never block in read(), waiting is done by waitForData()
+bool ubGPSLinuxSerial::open(const char *device, uint32_t baudRate)
+{
+    struct termios tio;
+    speed_t speed = toSpeed(baudRate);
+
+    close();
+    if(speed == B0)
+    {
+        return (false);
+    }
+    _fd = ::open(device, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if(_fd < 0)
+    {
+        return (false);
+    }
+    if(tcgetattr(_fd, &tio) < 0)
+    {
+        close();
+        return (false);
+    }
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~(CSTOPB | CRTSCTS);
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    if(tcsetattr(_fd, TCSANOW, &tio) < 0)
+    {
+        close();
+        return (false);
+    }
+    tcflush(_fd, TCIOFLUSH);
+
+    // ask the driver to pass bytes up without waiting for its flush timer
+    // not supported by every driver (and not by pseudo terminals), ignore errors
+    struct serial_struct serial;
+    if(ioctl(_fd, TIOCGSERIAL, &serial) == 0)
+    {
+        serial.flags |= ASYNC_LOW_LATENCY;
+        ioctl(_fd, TIOCSSERIAL, &serial);
+    }
+    _rxPos = 0;
+    _rxLen = 0;
+    return (true);
+}
+
+// closes the serial device
+void ubGPSLinuxSerial::close()
+{
+    if(_fd >= 0)
+    {
+        ::close(_fd);
+        _fd = -1;
+    }
+    _rxPos = 0;
+    _rxLen = 0;
+}
+
+// returns true if the device is open
+bool ubGPSLinuxSerial::isOpen()
+{
+    return (_fd >= 0);
+}
+
+// returns the file descriptor, e.g. to add the port to an external event loop
+int ubGPSLinuxSerial::getFD()
+{
+    return (_fd);
+}
+
+// blocks until bytes arrive or timeout (ms, -1 waits forever)
+bool ubGPSLinuxSerial::waitForData(int timeout)
+{
+    if(_rxPos < _rxLen)
+    {
+        return (true);
+    }
+    if(_fd < 0)
+    {
+        return (false);
+    }
+    struct pollfd pfd = { _fd, POLLIN, 0 };
+    int result;
+    do
+    {
+        result = poll(&pfd, 1, timeout);
+    }
+    while((result < 0) && (errno == EINTR));
+    if(result <= 0)
+    {
+        return (false);
+    }
+    _wakeTimestamp = micros();
+    return (fill());
+}
+
+// micros() when waitForData() woke up for the last time
+uint32_t ubGPSLinuxSerial::getWakeTimestamp()
+{
+    return (_wakeTimestamp);
+}
+
+// microseconds since the last wake up, call it from the message callback
+uint32_t ubGPSLinuxSerial::getWakeLatency()
+{
+    return (micros() - _wakeTimestamp);
+}
+
+// bulk read of all pending bytes into the receive buffer
+bool ubGPSLinuxSerial::fill()
+{
+    if(_rxPos >= _rxLen)
+    {
+        _rxPos = 0;
+        _rxLen = 0;
+    }
+    if(_rxLen < LINUX_RX_BUFFER)
+    {
+        ssize_t n = ::read(_fd, &_rxBuffer[_rxLen], LINUX_RX_BUFFER - _rxLen);
+        if(n > 0)
+        {
+            _rxLen += n;
+        }
+    }
+    return (_rxPos < _rxLen);
+}
+
+// returns number of buffered bytes, reads without blocking if the buffer is empty
+int ubGPSLinuxSerial::available()
+{
+    if((_rxPos >= _rxLen) && (_fd >= 0))
+    {
+        fill();
+    }
+    return (_rxLen - _rxPos);
+}
+
+// returns next byte or -1
+int ubGPSLinuxSerial::read()
+{
+    if(available() > 0)
+    {
+        return (_rxBuffer[_rxPos++]);
+    }
+    return (-1);
+}
+
+// returns next byte without removing it or -1
+int ubGPSLinuxSerial::peek()
+{
+    if(available() > 0)
+    {
+        return (_rxBuffer[_rxPos]);
+    }
+    return (-1);
+}
+
+// writes a single byte
+size_t ubGPSLinuxSerial::write(uint8_t value)
+{
+    return (write(&value, 1));
+}
+
+// writes a buffer, waits if the driver buffer is full
+size_t ubGPSLinuxSerial::write(const uint8_t *buffer, size_t size)
+{
+    size_t written = 0;
+    while((_fd >= 0) && (written < size))
+    {
+        ssize_t n = ::write(_fd, buffer + written, size - written);
+        if(n > 0)
+        {
+            written += n;
+        }
+        else if((n < 0) && (errno == EAGAIN))
+        {
+            struct pollfd pfd = { _fd, POLLOUT, 0 };
+            poll(&pfd, 1, 100);
+        }
+        else if(!((n < 0) && (errno == EINTR)))
+        {
+            break;
+        }
+    }
+    return (written);
+}
+
+// the kernel buffers outgoing data, report the free space of the driver queue
+int ubGPSLinuxSerial::availableForWrite()
+{
+    int queued = 0;
+    if((_fd < 0) || (ioctl(_fd, TIOCOUTQ, &queued) < 0))
+    {
+        return (0);
+    }
+    return (queued < LINUX_RX_BUFFER ? LINUX_RX_BUFFER - queued : 0);
+}
+
+// waits until all bytes are sent
+void ubGPSLinuxSerial::flush()
+{
+    if(_fd >= 0)
+    {
+        tcdrain(_fd);
+    }
+}
+
+// creates a pseudo terminal pair for testing without hardware
+// a simulated receiver writes to the returned master, the library opens slaveName
+int ubGPSLinuxSerial::openPseudoTerminal(char *slaveName, size_t length)
+{
+    int master = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if(master < 0)
+    {
+        return (-1);
+    }
+    if((grantpt(master) < 0) || (unlockpt(master) < 0) || (ptsname_r(master, slaveName, length) != 0))
+    {
+        ::close(master);
+        return (-1);
+    }
+    return (master);
+}
+
+#endif
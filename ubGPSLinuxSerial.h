@@ -0,0 +1,79 @@
+// ubGPSTime
+// get utc time from u-blox gps module
+// designed for nixie clocks...
+// Version 0.1.3 (alpha)
+
+// MIT license
+// Copyright 2021 highvoltglow
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), to deal in the Software without restriction, 
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, 
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software 
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR 
+// OTHER DEALINGS IN THE SOFTWARE.
+
+// POSIX serial port for Linux host builds
+// provides the Stream interface expected by ubGPSTime::begin()
+
+#ifndef UBGPSLINUXSERIAL_H
+#define UBGPSLINUXSERIAL_H
+
+#if defined(__linux__)
+
+#include <Arduino.h>
+
+#define LINUX_RX_BUFFER 4096
+
+class ubGPSLinuxSerial : public Stream
+{
+public:
+    ubGPSLinuxSerial();
+    ~ubGPSLinuxSerial();
+
+    bool open(const char *device, uint32_t baudRate);
+    void close();
+    bool isOpen();
+    int getFD();
+
+    // blocks until bytes arrive or timeout (ms, -1 waits forever)
+    // reads all pending bytes at once, returns true if data is available
+    bool waitForData(int timeout);
+    uint32_t getWakeTimestamp();
+    uint32_t getWakeLatency();
+
+    // creates a pseudo terminal pair for testing without hardware
+    // returns the master file descriptor, the slave can be opened by name
+    static int openPseudoTerminal(char *slaveName, size_t length);
+
+    // Stream interface
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t value) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    int availableForWrite() override;
+    void flush() override;
+
+private:
+    int _fd;
+    uint8_t _rxBuffer[LINUX_RX_BUFFER];
+    uint16_t _rxPos;
+    uint16_t _rxLen;
+    uint32_t _wakeTimestamp;
+
+    bool fill();
+};
+
+#endif
+
+#endif
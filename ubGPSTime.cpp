@@ -24,16 +24,52 @@
 
 
 #include <ubGPSTime.h>
+#include <math.h>
 
 // constructor
 ubGPSTime::ubGPSTime() : 
-    _serialPort(nullptr), _debugPort(nullptr),
-    _verbose(false), _initialized(false), 
-    _pending(pending::none), _notify(nullptr),
-    _timeUTC({}), _gpsStatus({})
+    _serialPort(nullptr), _baudRate(0), _debugPort(nullptr),
+#if UBGPS_VERBOSE
+    _verbose(false),
+#endif
+    _initialized(false), _pending(pending::none),
+#if UBGPS_CALLBACKS
+    _notify(nullptr),
+#endif
+    _timeUTC({}), _gpsStatus({}),
+#if UBGPS_MODULEVERSION
+    _moduleVersion(), _moduleCaps(),
+#endif
+    _polls(),
+    _message(), _fieldCounter(0), _payloadCounter(0),
+    _filters(), _filterCount(0), _filterEnabled(false), _skippedFrames(0),
+#if UBGPS_CHUNKED
+    _chunkNotify(nullptr), _chunkContext(nullptr), _chunk(), _streaming(false),
+#endif
+    _config(), _configCount(0), _configTimestamp(0),
+#if UBGPS_RECOVERY
+    _recoveryEnabled(true), _restoring(false), _restoreTimestamp(0), _recovery(), 
+    _navTimestamp(0), _nmeaSentences(0), _nmeaTimestamp(0), _nmeaState(0), _nmeaLength(0), _nmeaChecksum(0),
+#endif
+#if UBGPS_TIMING
+    _timing(), _timingHead(0), _timingCount(0), _timingInterval(0), _timingStats(), _timingM2(0),
+#endif
+#if UBGPS_SECOND
+    _secondNotify(nullptr), _secondLatency(SECOND_LATENCY), _secondAnchored(false), _secondAnchor({}), 
+    _secondBoundary(0), _nextSecond(0), _nextTime({}), _secondFired(false), _lastLabel(0), _secondStats(),
+#endif
+    _txQueue(nullptr), _txQueueSize(0), _txHead(0), _txCount(0)
 {
 } 
 
+// destructor, frees the payload of a frame in progress and the transmit queue
+ubGPSTime::~ubGPSTime()
+{
+    delete[] _message.payload;
+    delete[] _txQueue;
+}
+
+#if UBGPS_CALLBACKS
 // provides a callback function for message notification
 void ubGPSTime::attach(notifyCallBack callBack)
 {
@@ -45,11 +81,596 @@ void ubGPSTime::detach()
 {
     _notify = nullptr;
 }
+#endif
+
+#if UBGPS_RECOVERY
+// enables receiver reset detection and configuration recovery (default)
+void ubGPSTime::enableRecovery()
+{
+    _recoveryEnabled = true;
+}
+
+// disables receiver reset detection
+void ubGPSTime::disableRecovery()
+{
+    _recoveryEnabled = false;
+    _restoring = false;
+    _recovery.recovering = false;
+}
+
+// provides access to reset detection and recovery statistics
+const RECOVERYSTATS &ubGPSTime::getRecoveryStats()
+{
+    return (_recovery);
+}
+#endif
+
+// remembers a message rate to restore it after a receiver reset
+void ubGPSTime::recordRate(uint8_t msgClass, uint8_t msgID, uint8_t rate)
+{
+    uint8_t i = 0;
+    while((i < _configCount) && ((_config[i].msgClass != msgClass) || (_config[i].msgID != msgID)))
+    {
+        i++;
+    }
+    if(i == _configCount)
+    {
+        if(_configCount == MAX_CONFIG)
+        {
+            if(_verbose)
+            {
+                _debugPort->println("Configuration table full, rate will not be restored");
+            }
+            return;
+        }
+        _configCount++;
+    }
+    _config[i].msgClass = msgClass;
+    _config[i].msgID = msgID;
+    _config[i].rate = rate;
+    _config[i].applied = true;
+    _configTimestamp = millis();
+}
+
+#if UBGPS_RECOVERY
+// counts bytes outside of UBX frames and looks for NMEA sentences
+// NMEA output (including the boot banner) while NMEA is disabled means the receiver restarted
+void ubGPSTime::checkJunk(uint8_t value)
+{
+    _recovery.junkBytes++;
+    if(!scanNMEA(value))
+    {
+        return;
+    }
+    // count complete sentences within RESET_NMEA_WINDOW
+    if(!_nmeaSentences || (millis() - _nmeaTimestamp > RESET_NMEA_WINDOW))
+    {
+        _nmeaSentences = 0;
+        _nmeaTimestamp = millis();
+    }
+    _nmeaSentences++;
+    if(!_recoveryEnabled || _recovery.recovering || (millis() - _configTimestamp < RESET_GUARD))
+    {
+        _nmeaSentences = 0;
+        return;
+    }
+    if(_nmeaSentences >= RESET_NMEA_SENTENCES)
+    {
+        for(uint8_t i = 0; i < _configCount; i++)
+        {
+            if((_config[i].msgClass == UBX_NMEA) && (_config[i].rate == 0))
+            {
+                if(_verbose)
+                {
+                    _debugPort->println("NMEA output detected, receiver reset assumed");
+                }
+                onReset();
+                break;
+            }
+        }
+        _nmeaSentences = 0;
+    }
+}
+
+// true at the end of a complete sentence: $, address, fields, *hh, CR LF with matching checksum
+bool ubGPSTime::scanNMEA(uint8_t value)
+{
+    static const char hex[] = "0123456789ABCDEF";
+
+    if(value == '$')
+    {
+        _nmeaState = 1;
+        _nmeaLength = 1;
+        _nmeaChecksum = 0;
+        return (false);
+    }
+    if(!_nmeaState || (++_nmeaLength > NMEA_MAX_LENGTH))
+    {
+        _nmeaState = 0;
+        return (false);
+    }
+    switch(_nmeaState)
+    {
+        case 1: // address, talker and sentence type (GPGGA) or proprietary (PUBX)
+            if((value == ',') && (_nmeaLength >= 6) && (_nmeaLength <= 8))
+            {
+                _nmeaState++;
+            }
+            else if(!(((value >= 'A') && (value <= 'Z')) || ((value >= '0') && (value <= '9'))))
+            {
+                _nmeaState = 0;
+            }
+            _nmeaChecksum ^= value;
+            break;
+
+        case 2: // fields
+            if(value == '*')
+            {
+                _nmeaState++;
+            }
+            else if((value < 0x20) || (value > 0x7E))
+            {
+                _nmeaState = 0;
+            }
+            else
+            {
+                _nmeaChecksum ^= value;
+            }
+            break;
+
+        case 3: // checksum, high nibble
+            _nmeaState = (value == hex[_nmeaChecksum >> 4]) ? 4 : 0;
+            break;
+
+        case 4: // checksum, low nibble
+            _nmeaState = (value == hex[_nmeaChecksum & 0x0F]) ? 5 : 0;
+            break;
+
+        case 5:
+            _nmeaState = (value == '\r') ? 6 : 0;
+            break;
+
+        case 6:
+            _nmeaState = 0;
+            return (value == '\n');
+
+        default:
+            _nmeaState = 0;
+            break;
+    }
+    return (false);
+}
+
+// subscribed NAV messages stopped arriving
+void ubGPSTime::checkNavGap()
+{
+    uint8_t interval = 0;
+    for(uint8_t i = 0; i < _configCount; i++)
+    {
+        if((_config[i].msgClass == UBX_NAV) && _config[i].rate && 
+            (!interval || (_config[i].rate < interval)))
+        {
+            interval = _config[i].rate;
+        }
+    }
+    uint32_t now = millis();
+    if(!interval || _recovery.recovering || (now - _configTimestamp < RESET_GUARD))
+    {
+        return;
+    }
+    if((int32_t)(_configTimestamp - _navTimestamp) > 0)
+    {
+        // no NAV message since the last configuration change
+        _navTimestamp = _configTimestamp;
+    }
+    if(now - _navTimestamp > (uint32_t) interval * 1000UL * RESET_NAV_GAP)
+    {
+        if(_verbose)
+        {
+            _debugPort->println("NAV messages missing, receiver reset assumed");
+        }
+        onReset();
+    }
+}
+
+// marks the whole configuration as lost
+void ubGPSTime::onReset()
+{
+    _recovery.resets++;
+    _recovery.detected = millis();
+    _recovery.resetJunkBytes = _recovery.junkBytes;
+    _recovery.junkBytes = 0;
+    _recovery.recovering = true;
+    _navTimestamp = _recovery.detected;
+    _restoreTimestamp = _recovery.detected - RESTORE_RETRY;
+    for(uint8_t i = 0; i < _configCount; i++)
+    {
+        _config[i].applied = false;
+    }
+}
+
+// restores one message rate at a time without blocking
+void ubGPSTime::restoreConfig()
+{
+    if(!_recovery.recovering || _restoring || (millis() - _restoreTimestamp < RESTORE_RETRY))
+    {
+        return;
+    }
+    // NMEA first, it floods the serial port
+    for(uint8_t pass = 0; pass < 2; pass++)
+    {
+        for(uint8_t i = 0; i < _configCount; i++)
+        {
+            if(!_config[i].applied && ((_config[i].msgClass == UBX_NMEA) == (pass == 0)))
+            {
+                _restoring = queueMessageRate(_config[i].msgClass, _config[i].msgID, _config[i].rate,
+                    onRestoreResponse, this, POLL_TIMEOUT);
+                return;
+            }
+        }
+    }
+    _recovery.recovering = false;
+    _recovery.recoveryTime = millis() - _recovery.detected;
+    _configTimestamp = millis();
+    _navTimestamp = _configTimestamp;
+    if(_verbose)
+    {
+        _debugPort->printf("Configuration restored after %u ms, %u junk bytes\n", 
+            _recovery.recoveryTime, _recovery.junkBytes);
+    }
+}
+
+// result of a restore request, retried later if the receiver did not answer
+void ubGPSTime::onRestoreResponse(uint8_t msgClass, uint8_t msgID, UBXMESSAGE *message, void *context)
+{
+    ubGPSTime *gps = (ubGPSTime *) context;
+    gps->_restoring = false;
+    if(!message)
+    {
+        gps->_restoreTimestamp = millis();
+        return;
+    }
+    gps->_restoreTimestamp = millis() - RESTORE_RETRY;
+    for(uint8_t i = 0; i < gps->_configCount; i++)
+    {
+        if((gps->_config[i].msgClass == msgClass) && (gps->_config[i].msgID == msgID))
+        {
+            // a NACK will not get better by retrying
+            gps->_config[i].applied = true;
+        }
+    }
+}
+#endif
+
+#if UBGPS_TIMING
+// keeps the arrival of a navigation epoch, statistics are updated in constant time
+void ubGPSTime::addTimingSample(const TIMEUTC &time)
+{
+    if(!time.timeOfWeekValid)
+    {
+        return;
+    }
+    if(_timingCount)
+    {
+        const TIMINGSAMPLE &last = _timing[_timingHead];
+        uint32_t interval = time.timeOfWeek - last.timeOfWeek;
+        if(interval == 0)
+        {
+            // same epoch from NAV-TIMEUTC and NAV-PVT
+            return;
+        }
+        if((time.timeOfWeek < last.timeOfWeek) || (interval > 255000UL) || 
+            (_timingInterval && (interval != _timingInterval)))
+        {
+            // missed epoch, rate change or week rollover
+            _timingStats.gaps++;
+            _timingCount = 0;
+            _timingInterval = 0;
+        }
+        else
+        {
+            int32_t error = (int32_t)((time.rxTimestamp - last.rxTimestamp) - interval * 1000UL);
+            if(interval != _timingStats.interval)
+            {
+                // new message rate, the old statistics do not apply
+                uint32_t gaps = _timingStats.gaps;
+                _timingStats = {};
+                _timingStats.gaps = gaps;
+                _timingStats.interval = interval;
+                _timingM2 = 0;
+            }
+            _timingInterval = interval;
+            // mean and variance (Welford)
+            _timingStats.samples++;
+            float delta = error - _timingStats.meanError;
+            _timingStats.meanError += delta / _timingStats.samples;
+            _timingM2 += delta * (error - _timingStats.meanError);
+            _timingStats.meanAccuracy += ((float) time.accuracy - _timingStats.meanAccuracy) / _timingStats.samples;
+            if((_timingStats.samples == 1) || (error < _timingStats.minError))
+            {
+                _timingStats.minError = error;
+            }
+            if((_timingStats.samples == 1) || (error > _timingStats.maxError))
+            {
+                _timingStats.maxError = error;
+            }
+        }
+    }
+    _timingHead = _timingCount ? (_timingHead + 1) % TIMING_HISTORY : 0;
+    _timing[_timingHead].rxTimestamp = time.rxTimestamp;
+    _timing[_timingHead].timeOfWeek = time.timeOfWeek;
+    _timing[_timingHead].accuracy = time.accuracy;
+    if(_timingCount < TIMING_HISTORY)
+    {
+        _timingCount++;
+    }
+}
+
+// provides access to the timing statistics
+const TIMINGSTATS &ubGPSTime::getTimingStats()
+{
+    // square root only on request, it is expensive on small targets
+    _timingStats.stdDev = (_timingStats.samples > 1) ? sqrt(_timingM2 / (_timingStats.samples - 1)) : 0;
+    _timingStats.drift = _timingStats.interval ? _timingStats.meanError * 1000.0f / _timingStats.interval : 0;
+    return (_timingStats);
+}
+
+// clears statistics and history
+void ubGPSTime::resetTimingStats()
+{
+    _timingStats = {};
+    _timingM2 = 0;
+    _timingCount = 0;
+    _timingInterval = 0;
+}
+
+// provides access to the sample history
+const TIMINGSAMPLE *ubGPSTime::getTimingSample(uint8_t age)
+{
+    if(age >= _timingCount)
+    {
+        return (nullptr);
+    }
+    return (&_timing[(_timingHead + TIMING_HISTORY - age) % TIMING_HISTORY]);
+}
+
+// number of samples in the history
+uint8_t ubGPSTime::getTimingSamples()
+{
+    return (_timingCount);
+}
+
+// us the local clock ran ahead of GPS time since the oldest sample
+int32_t ubGPSTime::getTimingPhase(uint8_t age)
+{
+    const TIMINGSAMPLE *first = getTimingSample(_timingCount - 1);
+    const TIMINGSAMPLE *sample = getTimingSample(age);
+    return ((int32_t)((sample->rxTimestamp - first->rxTimestamp) - 
+        (sample->timeOfWeek - first->timeOfWeek) * 1000UL));
+}
+
+// overlapping Allan deviation from the arrival timestamps
+float ubGPSTime::getAllanDeviation(uint8_t n)
+{
+    if(!n || !_timingInterval || (_timingCount < 2 * n + 1))
+    {
+        return (0);
+    }
+    uint8_t terms = _timingCount - 2 * n;
+    float sum = 0;
+    for(uint8_t i = 0; i < terms; i++)
+    {
+        // oldest first, age counts back from the latest sample
+        uint8_t age = _timingCount - 1 - i;
+        float d = (float) getTimingPhase(age - 2 * n) - 2.0f * getTimingPhase(age - n) + getTimingPhase(age);
+        sum += d * d;
+    }
+    return (sqrt(sum / (2.0f * terms)) / (n * _timingInterval * 1000.0f));
+}
+#endif
+
+#if UBGPS_SECOND
+// provides a callback function for the start of each UTC second
+void ubGPSTime::onSecond(secondCallBack callBack, int32_t latency)
+{
+    _secondNotify = callBack;
+    _secondLatency = latency;
+    _secondStats = {};
+}
+
+// the time message was sent latency us after the epoch, the epoch is nanoSecond after the UTC second
+void ubGPSTime::updateSecond(const TIMEUTC &time)
+{
+    if(!time.utcValid)
+    {
+        return;
+    }
+    uint32_t boundary = time.rxTimestamp - _secondLatency - time.nanoSecond / 1000;
+    if(_secondAnchored)
+    {
+        uint32_t seconds = (secondOfDay(time) + 86400UL - secondOfDay(_secondAnchor)) % 86400UL;
+        if(seconds <= SECOND_HOLDOVER)
+        {
+            _secondStats.residual = (int32_t)(boundary - (_secondBoundary + seconds * 1000000UL));
+            int32_t residual = abs(_secondStats.residual);
+            if(residual > _secondStats.maxResidual)
+            {
+                _secondStats.maxResidual = residual;
+            }
+        }
+    }
+    _secondAnchor = time;
+    _secondBoundary = boundary;
+    _secondAnchored = true;
+    _nextSecond = boundary;
+    _nextTime = time;
+    _nextTime.nanoSecond = 0;
+    // skip the seconds that already fired, a passed second that did not fire yet is fired late
+    // (with latency 0 the boundary is the arrival time of the message itself)
+    while(_secondFired)
+    {
+        // the last tick or up to SECOND_HOLDOVER seconds before it fired already
+        uint32_t behind = (_lastLabel + 86400UL - secondOfDay(_nextTime)) % 86400UL;
+        if(behind > SECOND_HOLDOVER)
+        {
+            break;
+        }
+        advanceSecond();
+    }
+}
+
+// UTC second of the day, labels the ticks
+uint32_t ubGPSTime::secondOfDay(const TIMEUTC &time)
+{
+    return (time.hour * 3600UL + time.minute * 60UL + time.second);
+}
+
+// fires the callback once the predicted boundary is reached
+void ubGPSTime::serviceSecond()
+{
+    if(!_secondNotify || !_secondAnchored)
+    {
+        return;
+    }
+    uint32_t now = micros();
+    if((int32_t)(now - _nextSecond) < 0)
+    {
+        return;
+    }
+    if(_nextSecond - _secondBoundary > SECOND_HOLDOVER * 1000000UL)
+    {
+        // no time messages for too long, stop ticking until the next one
+        _secondAnchored = false;
+        return;
+    }
+    // fire once for the latest boundary if process() was not called in time
+    while((int32_t)(now - _nextSecond) >= 1000000L)
+    {
+        _secondStats.missed++;
+        advanceSecond();
+    }
+    TIMEUTC time = _nextTime;
+    time.timestamp = millis();
+    time.rxTimestamp = _nextSecond;
+    _secondStats.ticks++;
+    _secondStats.lateness = (int32_t)(now - _nextSecond);
+    if(_secondStats.lateness > _secondStats.maxLateness)
+    {
+        _secondStats.maxLateness = _secondStats.lateness;
+    }
+    if(_nextSecond - _secondBoundary >= 1500000UL)
+    {
+        _secondStats.holdover++;
+    }
+    _secondFired = true;
+    _lastLabel = secondOfDay(_nextTime);
+    advanceSecond();
+    _secondNotify(&time);
+}
+
+// moves the next boundary one second ahead
+void ubGPSTime::advanceSecond()
+{
+    _nextSecond += 1000000UL;
+    tickTime(&_nextTime);
+}
+
+// adds one second to date and time, leap seconds are not inserted
+void ubGPSTime::tickTime(TIMEUTC *time)
+{
+    static const uint8_t daysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+    time->timeOfWeek = (time->timeOfWeek + 1000) % 604800000UL;
+    if(++time->second < 60)
+    {
+        return;
+    }
+    time->second = 0;
+    if(++time->minute < 60)
+    {
+        return;
+    }
+    time->minute = 0;
+    if(++time->hour < 24)
+    {
+        return;
+    }
+    time->hour = 0;
+    uint8_t days = daysInMonth[(time->month + 11) % 12];
+    if((time->month == 2) && ((time->year % 4 == 0) && ((time->year % 100 != 0) || (time->year % 400 == 0))))
+    {
+        days++;
+    }
+    if(++time->day <= days)
+    {
+        return;
+    }
+    time->day = 1;
+    if(++time->month <= 12)
+    {
+        return;
+    }
+    time->month = 1;
+    time->year++;
+}
+
+// us until the next second boundary
+int32_t ubGPSTime::getMicrosToSecond()
+{
+    if(!_secondAnchored)
+    {
+        return (-1);
+    }
+    int32_t remaining = (int32_t)(_nextSecond - micros());
+    return ((remaining > 0) ? remaining : 0);
+}
+
+// provides access to the scheduling statistics
+const SECONDSTATS &ubGPSTime::getSecondStats()
+{
+    return (_secondStats);
+}
+#endif
+
+#if UBGPS_CHUNKED
+// provides a callback function for messages larger than MAX_PAYLOAD
+void ubGPSTime::attachChunked(chunkCallBack callBack, void *context)
+{
+    _chunkNotify = callBack;
+    _chunkContext = context;
+}
+
+// stop getting large messages, they will be dismissed again
+void ubGPSTime::detachChunked()
+{
+    _chunkNotify = nullptr;
+    _chunkContext = nullptr;
+}
+#endif
 
 // defines serial com port to GPS module
-void ubGPSTime::begin(Stream &serialPort)
+// the baud rate is optional and only used to compensate the UART transit time
+void ubGPSTime::begin(Stream &serialPort, uint32_t baudRate)
 {
     _serialPort = &serialPort;
+    _baudRate = baudRate;
+}
+
+// updates the baud rate used by the latency model, use 0 to disable compensation
+void ubGPSTime::setBaudRate(uint32_t baudRate)
+{
+    _baudRate = baudRate;
+}
+
+// returns the time in microseconds needed to transfer the given number of bytes
+// returns 0 if the baud rate is unknown
+uint32_t ubGPSTime::getTransitTime(uint16_t bytes)
+{
+    if(_baudRate == 0)
+    {
+        return (0);
+    }
+    return ((uint32_t)(((uint64_t)bytes * UART_BITS_PER_BYTE * 1000000UL) / _baudRate));
 }
 
 // asking about GPS module information
@@ -72,23 +693,40 @@ void ubGPSTime::initialize()
 // reads from serial port
 void ubGPSTime::process()
 {
-    static UBXMESSAGE message = {};
-    static uint16_t fieldCounter = 0;
-    static uint16_t payloadCounter = 0;
-    char c = 0;
+    // parser state is kept per instance, several receivers can be processed
+    UBXMESSAGE &message = _message;
+    uint16_t &fieldCounter = _fieldCounter;
+    uint16_t &payloadCounter = _payloadCounter;
+    uint8_t c = 0;
 
     if(_serialPort)
     {
+#if UBGPS_SECOND
+        serviceSecond();
+#endif
+        drainTxQueue();
         while(_serialPort->available())
         {
             c = _serialPort->read(); 
             switch(fieldCounter)
             {
                 case 0: // header 1
-                    if(c == UBX_HEADER1)
+                    if(c != UBX_HEADER1)
+                    {
+#if UBGPS_RECOVERY
+                        checkJunk(c);
+#endif
+                    }
+                    else
                     {
+                        // bytes still waiting in the receive buffer arrived after the header,
+                        // the first bit of the header went over the wire one byte time earlier
+                        message.rxTimestamp = micros() - getTransitTime(_serialPort->available() + 1);
                         message.header1 = c;
                         fieldCounter++;
+#if UBGPS_CHUNKED
+                        _streaming = false;
+#endif
                         // free memory if we missed a delete
                         if(message.payload)
                         {
@@ -127,7 +765,19 @@ void ubGPSTime::process()
 
                 case 5: // length (second of 2 bytes, little endian)
                     message.payloadLength |= c << 8;
-                    if(message.payloadLength == 0)
+                    payloadCounter = 0;
+                    if(!isAccepted(message.msgClass, message.msgID) && 
+#if UBGPS_CHUNKED
+                        (_chunkNotify || (message.payloadLength <= MAX_PAYLOAD)))
+#else
+                        (message.payloadLength <= MAX_PAYLOAD))
+#endif
+                    {
+                        // unwanted message, skip payload and checksum by length
+                        _skippedFrames++;
+                        fieldCounter = message.payloadLength ? 9 : 10;
+                    }
+                    else if(message.payloadLength == 0)
                     {
                         // skip payload
                         fieldCounter+=2;
@@ -135,10 +785,21 @@ void ubGPSTime::process()
                     }
                     else if(message.payloadLength > MAX_PAYLOAD)
                     {
-                        // payload larger as max supported size
-                        // dismiss message and resync
-                        fieldCounter = 0;
-                        payloadCounter = 0;
+#if UBGPS_CHUNKED
+                        if(_chunkNotify && beginChunks())
+                        {
+                            // deliver payload in chunks
+                            fieldCounter++;
+                        }
+                        else
+#endif
+                        {
+                            // payload larger as max supported size (or declined by the chunk handler)
+                            // dismiss message and resync, a corrupted length must not swallow valid frames
+                            _skippedFrames++;
+                            fieldCounter = 0;
+                            payloadCounter = 0;
+                        }
                     }
                     else
                     {
@@ -149,7 +810,16 @@ void ubGPSTime::process()
                     break;
 
                 case 6: // payload
-                    message.payload[payloadCounter] = c;
+#if UBGPS_CHUNKED
+                    if(_streaming)
+                    {
+                        addChunkByte(c);
+                    }
+                    else
+#endif
+                    {
+                        message.payload[payloadCounter] = c;
+                    }
                     payloadCounter++;
                     if(payloadCounter == message.payloadLength)
                     {
@@ -167,7 +837,16 @@ void ubGPSTime::process()
                     message.CK_B = c;
                     fieldCounter = 0;
                     payloadCounter = 0;
-                    processMessage(&message);
+#if UBGPS_CHUNKED
+                    if(_streaming)
+                    {
+                        endChunks();
+                    }
+                    else
+#endif
+                    {
+                        processMessage(&message);
+                    }
                     // free memory after processing message
                     if(message.payload)
                     {
@@ -176,12 +855,41 @@ void ubGPSTime::process()
                     }
                     break;    
 
+                case 9: // skipped payload
+                    payloadCounter++;
+                    if(payloadCounter == message.payloadLength)
+                    {
+                        fieldCounter++;
+                        payloadCounter = 0;
+                    }
+                    break;
+
+                case 10: // skipped checksum
+                    payloadCounter++;
+                    if(payloadCounter == 2)
+                    {
+                        fieldCounter = 0;
+                        payloadCounter = 0;
+                    }
+                    break;
+
                 default:
                     fieldCounter = 0;
                     payloadCounter = 0;
                     break;           
             }
         }
+        servicePolls();
+#if UBGPS_SECOND
+        serviceSecond();
+#endif
+#if UBGPS_RECOVERY
+        if(_recoveryEnabled)
+        {
+            checkNavGap();
+            restoreConfig();
+        }
+#endif
     }
     else
     {
@@ -193,24 +901,37 @@ void ubGPSTime::process()
 }
 
 // enable debug information
+// without UBGPS_VERBOSE debug output is compiled out and this has no effect
 void ubGPSTime::enableVerbose(Stream &debugPort)
 {
     _debugPort = &debugPort;
+#if UBGPS_VERBOSE
     _verbose = true;
+#endif
 }
 
 // disable debug information
 void ubGPSTime::disableVerbose()
 {
+#if UBGPS_VERBOSE
     _verbose = false;
+#endif
 }
 
+#if UBGPS_MODULEVERSION
 // provides access to the module version data
-MODULEVERSION ubGPSTime::getModuleVersion()
+const MODULEVERSION &ubGPSTime::getModuleVersion()
 {
     return (_moduleVersion);
 }
 
+// provides access to the module capabilities decoded from the version data
+const MODULECAPS &ubGPSTime::getModuleCaps()
+{
+    return (_moduleCaps);
+}
+#endif
+
 // provides access to last updated time data
 TIMEUTC ubGPSTime::getTimeUTC()
 {
@@ -283,22 +1004,302 @@ void ubGPSTime::sendMessage(UBXMESSAGE *message)
             printMessage(message, direction::outgoing);
         }
 
-        _serialPort->write(message->header1);
-        _serialPort->write(message->header2);
-        _serialPort->write(message->msgClass);
-        _serialPort->write(message->msgID);
-        _serialPort->write(message->payloadLength & 0xFF); 
-        _serialPort->write(message->payloadLength >> 8);   
+        uint8_t frame[UBX_FRAME_OVERHEAD + TX_FRAME_PAYLOAD];
+        frame[0] = message->header1;
+        frame[1] = message->header2;
+        frame[2] = message->msgClass;
+        frame[3] = message->msgID;
+        frame[4] = message->payloadLength & 0xFF;
+        frame[5] = message->payloadLength >> 8;
+        if(message->payloadLength <= TX_FRAME_PAYLOAD)
+        {
+            // assemble the whole frame, single write
+            if(message->payloadLength)
+            {
+                memcpy(&frame[6], message->payload, message->payloadLength);
+            }
+            frame[6 + message->payloadLength] = message->CK_A;
+            frame[7 + message->payloadLength] = message->CK_B;
+            writeBytes(frame, UBX_FRAME_OVERHEAD + message->payloadLength);
+        }
+        else
+        {
+            // payload is already contiguous, no need to copy it
+            writeBytes(frame, 6);
+            writeBytes(message->payload, message->payloadLength);
+            frame[0] = message->CK_A;
+            frame[1] = message->CK_B;
+            writeBytes(frame, 2);
+        }
+    }
+    else
+    {
+        if(_verbose)
+        {
+            _debugPort->println("Com port not defined. Call begin first");
+        }
+    }
+}
+
+#if UBGPS_CHUNKED
+// starts delivering a large payload, returns false if the handler declines the message
+bool ubGPSTime::beginChunks()
+{
+    _chunk.msgClass = _message.msgClass;
+    _chunk.msgID = _message.msgID;
+    _chunk.payloadLength = _message.payloadLength;
+    _chunk.offset = 0;
+    _chunk.length = 0;
+    _chunk.data = nullptr;
+    _chunk.valid = false;
+    _chunk.rxTimestamp = _message.rxTimestamp;
+    _chunk.checksum.CK_A = 0;
+    _chunk.checksum.CK_B = 0;
+    stepChecksum(_message.msgClass, &_chunk.checksum);
+    stepChecksum(_message.msgID, &_chunk.checksum);
+    stepChecksum(_message.payloadLength & 0xFF, &_chunk.checksum);
+    stepChecksum(_message.payloadLength >> 8, &_chunk.checksum);
+    if(!_chunkNotify(chunkEvent::begin, &_chunk, _chunkContext))
+    {
+        return (false);
+    }
+    _message.payload = new uint8_t[CHUNK_SIZE];
+    _chunk.data = _message.payload;
+    _streaming = true;
+    return (true);
+}
+
+// buffers a payload byte, the handler gets the chunk when the buffer is full
+void ubGPSTime::addChunkByte(uint8_t value)
+{
+    _message.payload[_chunk.length] = value;
+    _chunk.length++;
+    stepChecksum(value, &_chunk.checksum);
+    if((_chunk.length == CHUNK_SIZE) || (_chunk.offset + _chunk.length == _chunk.payloadLength))
+    {
+        if(_chunkNotify)
+        {
+            _chunkNotify(chunkEvent::data, &_chunk, _chunkContext);
+        }
+        _chunk.offset += _chunk.length;
+        _chunk.length = 0;
+    }
+}
+
+// finishes a large payload with the checksum result
+void ubGPSTime::endChunks()
+{
+    _streaming = false;
+    _chunk.valid = (_chunk.checksum.CK_A == _message.CK_A) && (_chunk.checksum.CK_B == _message.CK_B);
+    _chunk.length = 0;
+    if(_chunkNotify)
+    {
+        _chunkNotify(chunkEvent::end, &_chunk, _chunkContext);
+    }
+    // pending polls complete with the header only, the payload went to the chunk handler
+    if(_chunk.valid)
+    {
+        UBXMESSAGE header = _message;
+        header.payload = nullptr;
+        header.payloadLength = 0;
+        completePolls(&header);
+    }
+    if(_verbose)
+    {
+        _debugPort->printf("Chunked message %02X %02X, %u bytes, checksum %s\n", 
+            _chunk.msgClass, _chunk.msgID, _chunk.payloadLength, _chunk.valid ? "ok" : "failed");
+    }
+}
+#endif
+
+// enables the message filter
+void ubGPSTime::enableFilter()
+{
+    _filterEnabled = true;
+}
+
+// disables the message filter, all messages are processed
+void ubGPSTime::disableFilter()
+{
+    _filterEnabled = false;
+}
 
-        //Write payload.
-        for (uint16_t i = 0; i < message->payloadLength; i++)
+// adds a message to the filter, returns false if the filter is full
+bool ubGPSTime::acceptMessage(uint8_t msgClass, uint8_t msgID)
+{
+    return (addFilter(msgClass, msgID, false));
+}
+
+// adds all messages of a class to the filter, returns false if the filter is full
+bool ubGPSTime::acceptClass(uint8_t msgClass)
+{
+    return (addFilter(msgClass, 0, true));
+}
+
+// removes all messages from the filter
+void ubGPSTime::clearFilter()
+{
+    _filterCount = 0;
+}
+
+// returns the number of frames skipped by the filter
+uint32_t ubGPSTime::getSkippedFrames()
+{
+    return (_skippedFrames);
+}
+
+// adds a filter entry
+bool ubGPSTime::addFilter(uint8_t msgClass, uint8_t msgID, bool anyID)
+{
+    if(_filterCount >= MAX_FILTERS)
+    {
+        return (false);
+    }
+    _filters[_filterCount].msgClass = msgClass;
+    _filters[_filterCount].msgID = msgID;
+    _filters[_filterCount].anyID = anyID;
+    _filterCount++;
+    return (true);
+}
+
+// checks a message header against the filter
+bool ubGPSTime::isAccepted(uint8_t msgClass, uint8_t msgID)
+{
+    if(!_filterEnabled || (msgClass == UBX_ACK))
+    {
+        return (true);
+    }
+    for(uint8_t i = 0; i < _filterCount; i++)
+    {
+        if((_filters[i].msgClass == msgClass) && (_filters[i].anyID || (_filters[i].msgID == msgID)))
+        {
+            return (true);
+        }
+    }
+    // responses to pending requests
+    for(uint8_t i = 0; i < MAX_POLLS; i++)
+    {
+        if((_polls[i].state != pollState::free) && !_polls[i].config &&
+            (_polls[i].msgClass == msgClass) && (_polls[i].msgID == msgID))
+        {
+            return (true);
+        }
+    }
+    return ((_pending == pending::version) && (msgClass == UBX_MON) && (msgID == UBX_MON_VER));
+}
+
+// enables a non-blocking transmit queue drained by process() as the port accepts bytes
+// requires a port that reports availableForWrite() (SoftwareSerial does not)
+void ubGPSTime::enableTxQueue(uint16_t size)
+{
+    disableTxQueue();
+    _txQueue = new uint8_t[size];
+    _txQueueSize = size;
+}
+
+// sends remaining queued bytes and releases the transmit queue
+void ubGPSTime::disableTxQueue()
+{
+    if(_txQueue)
+    {
+        flushTxQueue();
+        delete[] _txQueue;
+        _txQueue = nullptr;
+        _txQueueSize = 0;
+    }
+}
+
+// writes bytes to the serial port or appends them to the transmit queue
+void ubGPSTime::writeBytes(const uint8_t *data, uint16_t length)
+{
+    if(!_txQueue)
+    {
+        _serialPort->write(data, length);
+        return;
+    }
+    if(length > _txQueueSize - _txCount)
+    {
+        // no room left, keep the byte order and send blocking
+        flushTxQueue();
+        _serialPort->write(data, length);
+        return;
+    }
+    while(length)
+    {
+        uint16_t tail = (_txHead + _txCount) % _txQueueSize;
+        uint16_t n = _txQueueSize - tail;
+        if(n > length)
+        {
+            n = length;
+        }
+        memcpy(&_txQueue[tail], data, n);
+        _txCount += n;
+        data += n;
+        length -= n;
+    }
+    drainTxQueue();
+}
+
+// writes as many queued bytes as the port accepts without blocking
+// ports without availableForWrite() (Print default, SoftwareSerial) report 0, 
+// at least one byte is written per call so that the queue keeps moving
+void ubGPSTime::drainTxQueue()
+{
+    bool first = true;
+    while(_txCount)
+    {
+        int room = _serialPort->availableForWrite();
+        if((room <= 0) && first)
+        {
+            room = 1;
+        }
+        else if(room <= 0)
+        {
+            break;
+        }
+        first = false;
+        uint16_t n = _txQueueSize - _txHead;
+        if(n > _txCount)
+        {
+            n = _txCount;
+        }
+        if(n > (uint16_t)room)
+        {
+            n = room;
+        }
+        _serialPort->write(&_txQueue[_txHead], n);
+        _txHead = (_txHead + n) % _txQueueSize;
+        _txCount -= n;
+    }
+}
+
+// writes all queued bytes, blocking
+void ubGPSTime::flushTxQueue()
+{
+    while(_txCount)
+    {
+        uint16_t n = _txQueueSize - _txHead;
+        if(n > _txCount)
+        {
+            n = _txCount;
+        }
+        _serialPort->write(&_txQueue[_txHead], n);
+        _txHead = (_txHead + n) % _txQueueSize;
+        _txCount -= n;
+    }
+    _txHead = 0;
+}
+
+// send a complete frame (headers and checksum included) to gps module
+void ubGPSTime::sendFrame(const uint8_t *frame, uint16_t length)
+{
+    if(_serialPort)
+    {
+        if(_verbose)
         {
-            _serialPort->write(message->payload[i]);
+            printFrame(frame, length);
         }
-
-        //Write checksum
-        _serialPort->write(message->CK_A);
-        _serialPort->write(message->CK_B);    
+        writeBytes(frame, length);
     }
     else
     {
@@ -309,15 +1310,33 @@ void ubGPSTime::sendMessage(UBXMESSAGE *message)
     }
 }
 
+// changes a byte of a frame and updates the checksum without recalculating it
+// a body byte at index contributes once to CK_A and (length - 2 - index) times to CK_B
+void ubGPSTime::setFrameByte(uint8_t *frame, uint16_t length, uint16_t index, uint8_t value)
+{
+    uint8_t delta = value - frame[index];
+    frame[index] = value;
+    frame[length - 2] += delta;
+    frame[length - 1] += (uint8_t)((length - 2 - index) * delta);
+}
+
 // disable default NMEA messages sent by GPS module
 void ubGPSTime::disableDefaultNMEA()
 {
-    setMessageRate(UBX_NMEA, UBX_NMEA_GGA, 0);
-    setMessageRate(UBX_NMEA, UBX_NMEA_GLL, 0);
-    setMessageRate(UBX_NMEA, UBX_NMEA_GSA, 0);
-    setMessageRate(UBX_NMEA, UBX_NMEA_GSV, 0);
-    setMessageRate(UBX_NMEA, UBX_NMEA_RMC, 0);
-    setMessageRate(UBX_NMEA, UBX_NMEA_VTG, 0);
+    static const uint8_t *const frames[] = 
+    {
+        UBXRATEFRAME<UBX_NMEA, UBX_NMEA_GGA, 0>::data,
+        UBXRATEFRAME<UBX_NMEA, UBX_NMEA_GLL, 0>::data,
+        UBXRATEFRAME<UBX_NMEA, UBX_NMEA_GSA, 0>::data,
+        UBXRATEFRAME<UBX_NMEA, UBX_NMEA_GSV, 0>::data,
+        UBXRATEFRAME<UBX_NMEA, UBX_NMEA_RMC, 0>::data,
+        UBXRATEFRAME<UBX_NMEA, UBX_NMEA_VTG, 0>::data
+    };
+    for(uint8_t i = 0; i < sizeof(frames) / sizeof(frames[0]); i++)
+    {
+        // frame bytes 6 to 8 are class, id and rate of the configured message
+        configureRate(frames[i][6], frames[i][7], frames[i][8], frames[i], true);
+    }
 }
 
 // prints a message on debug port
@@ -353,6 +1372,20 @@ void ubGPSTime::printMessage(UBXMESSAGE *message, direction dir)
     }
 }
 
+// prints a complete outgoing frame on debug port
+void ubGPSTime::printFrame(const uint8_t *frame, uint16_t length)
+{
+    if(_verbose)
+    {
+        _debugPort->print(F("UBX Message --> "));
+        for(uint16_t i = 0; i < length; i++)
+        {
+            printHEX(frame[i]);
+        }
+        _debugPort->println();
+    }
+}
+
 // prints a byte in HEX format 
 void ubGPSTime::printHEX(uint8_t value)
 {
@@ -370,6 +1403,10 @@ void ubGPSTime::processMessage(UBXMESSAGE *message)
 {
     if(validateChecksum(message))
     {
+#if UBGPS_RECOVERY
+        // the receiver still talks UBX, earlier NMEA did not come from a restart
+        _nmeaSentences = 0;
+#endif
         if(_verbose)
         {
             printMessage(message, direction::incoming);
@@ -395,16 +1432,30 @@ void ubGPSTime::processMessage(UBXMESSAGE *message)
                 break;
 
             case UBX_NAV:
+#if UBGPS_RECOVERY
+                _navTimestamp = millis();
+#endif
+#if UBGPS_NAV_STATUS
                 if(message->msgID == UBX_NAV_STATUS)
                 {
                     onStatus(message);
                 }
+#endif
+#if UBGPS_NAV_TIMEUTC
                 if(message->msgID == UBX_NAV_TIMEUTC)
                 {
                     onTimeUTC(message);
                 }
+#endif
+#if UBGPS_NAV_PVT
+                if(message->msgID == UBX_NAV_PVT)
+                {
+                    onPVT(message);
+                }
+#endif
                 break;
         }
+        completePolls(message);
         onMessageEvent(message);    
     }
     else
@@ -434,19 +1485,18 @@ bool ubGPSTime::waitForResponse(uint32_t timeout)
 // use rate = 0 to stop the module from sending updates
 void ubGPSTime::setMessageRate(uint8_t msgClass, uint8_t msgID, uint8_t rate, bool wait)
 {
-    UBXMESSAGE message;
-    uint8_t payLoad[3];
-
-    message.payload = payLoad;
-    message.header1 = UBX_HEADER1;
-    message.header2 = UBX_HEADER2;
-    message.msgClass = UBX_CFG;
-    message.msgID = UBX_CFG_MSG;
-    message.payloadLength = 3;
-    message.payload[0] = msgClass;
-    message.payload[1] = msgID;
-    message.payload[2] = rate;
-    sendMessage(&message); 
+    configureRate(msgClass, msgID, rate, nullptr, wait);
+}
+
+// queues a message rate configuration like the non blocking requests, the receiver
+// answers CFG-MSG without naming the message, only one can be in flight
+void ubGPSTime::configureRate(uint8_t msgClass, uint8_t msgID, uint8_t rate, const uint8_t *frame, bool wait)
+{
+    recordRate(msgClass, msgID, rate);
+    if(!queueMessageRate(msgClass, msgID, rate, onConfigResponse, this, WAIT_FOR_RESPONSE, frame))
+    {
+        return;
+    }
     _pending = pending::ack;
     if(wait)
     {      
@@ -454,65 +1504,413 @@ void ubGPSTime::setMessageRate(uint8_t msgClass, uint8_t msgID, uint8_t rate, bo
     }   
 }
 
+// ACK, NACK or timeout of a blocking configuration, the wait ends when all are answered
+void ubGPSTime::onConfigResponse(uint8_t msgClass, uint8_t msgID, UBXMESSAGE *message, void *context)
+{
+    ubGPSTime *gps = (ubGPSTime *) context;
+    (void) msgClass;
+    (void) msgID;
+    (void) message;
+    if((gps->_pending == pending::ack) && !gps->isConfigPending())
+    {
+        gps->_pending = pending::none;
+    }
+}
+
+// returns true if a message rate configuration is queued or in flight
+bool ubGPSTime::isConfigPending()
+{
+    for(uint8_t i = 0; i < MAX_POLLS; i++)
+    {
+        if((_polls[i].state != pollState::free) && _polls[i].config)
+        {
+            return (true);
+        }
+    }
+    return (false);
+}
+
+// sets update rate without waiting, the request is queued like a poll request
+// the callback is called with the ACK or NACK message or with a nullptr message after timeout (ms)
+// returns false if the request queue is full
+bool ubGPSTime::setMessageRate(uint8_t msgClass, uint8_t msgID, uint8_t rate, pollCallBack callBack, 
+    void *context, uint32_t timeout)
+{
+    if(!queueMessageRate(msgClass, msgID, rate, callBack, context, timeout))
+    {
+        return (false);
+    }
+    recordRate(msgClass, msgID, rate);
+    return (true);
+}
+
+// queues a message rate configuration request
+bool ubGPSTime::queueMessageRate(uint8_t msgClass, uint8_t msgID, uint8_t rate, pollCallBack callBack, 
+    void *context, uint32_t timeout, const uint8_t *frame)
+{
+    POLLREQUEST *request = allocatePoll();
+    if(!request)
+    {
+        return (false);
+    }
+    request->msgClass = msgClass;
+    request->msgID = msgID;
+    request->rate = rate;
+    request->frame = frame;
+    request->config = true;
+    request->callBack = callBack;
+    request->context = context;
+    request->timeout = timeout;
+    request->timestamp = millis();
+    request->state = pollState::queued;
+    servicePolls();
+    return (true);
+}
+
+// sends a message rate configuration (CFG-MSG)
+void ubGPSTime::sendMessageRate(uint8_t msgClass, uint8_t msgID, uint8_t rate)
+{
+    typedef UBXRATEFRAME<0, 0, 0> frameTemplate;
+    uint8_t frame[frameTemplate::length];
+
+    memcpy(frame, frameTemplate::data, frameTemplate::length);
+    setFrameByte(frame, frameTemplate::length, 6, msgClass);
+    setFrameByte(frame, frameTemplate::length, 7, msgID);
+    setFrameByte(frame, frameTemplate::length, 8, rate);
+    sendFrame(frame, frameTemplate::length);
+}
+
 // requests a single message
 void ubGPSTime::pollMessage(uint8_t msgClass, uint8_t msgID)
 {
-    UBXMESSAGE message;
+    typedef UBXPOLLFRAME<0, 0> frameTemplate;
+    uint8_t frame[frameTemplate::length];
+
+    memcpy(frame, frameTemplate::data, frameTemplate::length);
+    setFrameByte(frame, frameTemplate::length, 2, msgClass);
+    setFrameByte(frame, frameTemplate::length, 3, msgID);
+    sendFrame(frame, frameTemplate::length);
+}
+
+// queues a poll request, requests for the same message are coalesced
+// the request is sent as soon as less than MAX_POLLS_IN_FLIGHT requests are waiting for a response
+// the callback is called with the response or with a nullptr message after timeout (ms)
+// returns false if the request queue is full
+bool ubGPSTime::poll(uint8_t msgClass, uint8_t msgID, pollCallBack callBack, void *context, uint32_t timeout)
+{
+    for(uint8_t i = 0; i < MAX_POLLS; i++)
+    {
+        POLLREQUEST *p = &_polls[i];
+        if((p->state != pollState::free) && !p->config &&
+            (p->msgClass == msgClass) && (p->msgID == msgID) && 
+            (p->callBack == callBack) && (p->context == context))
+        {
+            // same request already pending
+            return (true);
+        }
+    }
+    POLLREQUEST *request = allocatePoll();
+    if(!request)
+    {
+        return (false);
+    }
+    request->msgClass = msgClass;
+    request->msgID = msgID;
+    request->config = false;
+    request->callBack = callBack;
+    request->context = context;
+    request->timeout = timeout;
+    request->timestamp = millis();
+    request->state = pollState::queued;
+    servicePolls();
+    return (true);
+}
+
+// returns a free request entry or nullptr if the queue is full
+ubGPSTime::POLLREQUEST *ubGPSTime::allocatePoll()
+{
+    for(uint8_t i = 0; i < MAX_POLLS; i++)
+    {
+        if(_polls[i].state == pollState::free)
+        {
+            return (&_polls[i]);
+        }
+    }
+    if(_verbose)
+    {
+        _debugPort->println("Poll queue full");
+    }
+    return (nullptr);
+}
+
+// returns the number of queued and in flight poll requests
+uint8_t ubGPSTime::getPendingPolls()
+{
+    uint8_t count = 0;
+    for(uint8_t i = 0; i < MAX_POLLS; i++)
+    {
+        if(_polls[i].state != pollState::free)
+        {
+            count++;
+        }
+    }
+    return (count);
+}
+
+// returns true if a request for the given message was sent and is waiting for a response
+bool ubGPSTime::isInFlight(uint8_t msgClass, uint8_t msgID)
+{
+    for(uint8_t i = 0; i < MAX_POLLS; i++)
+    {
+        if((_polls[i].state == pollState::inflight) && !_polls[i].config &&
+            (_polls[i].msgClass == msgClass) && (_polls[i].msgID == msgID))
+        {
+            return (true);
+        }
+    }
+    return (false);
+}
+
+// returns the number of different messages requested and waiting for a response
+uint8_t ubGPSTime::pollsInFlight()
+{
+    uint8_t count = 0;
+    for(uint8_t i = 0; i < MAX_POLLS; i++)
+    {
+        if(_polls[i].state == pollState::inflight)
+        {
+            // count coalesced requests only once
+            bool first = true;
+            for(uint8_t j = 0; (j < i) && !_polls[i].config; j++)
+            {
+                if((_polls[j].state == pollState::inflight) && !_polls[j].config && 
+                    (_polls[j].msgClass == _polls[i].msgClass) && (_polls[j].msgID == _polls[i].msgID))
+                {
+                    first = false;
+                    break;
+                }
+            }
+            if(first)
+            {
+                count++;
+            }
+        }
+    }
+    return (count);
+}
+
+// times out unanswered requests and sends queued requests, oldest first
+void ubGPSTime::servicePolls()
+{
+    uint32_t now = millis();
+    for(uint8_t i = 0; i < MAX_POLLS; i++)
+    {
+        POLLREQUEST *p = &_polls[i];
+        if((p->state == pollState::inflight) && (now - p->timestamp >= p->timeout))
+        {
+            POLLREQUEST request = *p;
+            p->state = pollState::free;
+            if(_verbose)
+            {
+                _debugPort->println("Poll request timed out");
+            }
+            if(request.callBack)
+            {
+                request.callBack(request.msgClass, request.msgID, nullptr, request.context);
+            }
+        }
+    }
+
+    // ACK/NACK do not name the configured message, configurations are sent one at a time
+    bool configInFlight = false;
+    for(uint8_t i = 0; i < MAX_POLLS; i++)
+    {
+        if((_polls[i].state == pollState::inflight) && _polls[i].config)
+        {
+            configInFlight = true;
+        }
+    }
+
+    while(true)
+    {
+        POLLREQUEST *oldest = nullptr;
+        for(uint8_t i = 0; i < MAX_POLLS; i++)
+        {
+            POLLREQUEST *p = &_polls[i];
+            if((p->state == pollState::queued) && !(p->config && configInFlight) &&
+                (!oldest || (int32_t)(p->timestamp - oldest->timestamp) < 0))
+            {
+                oldest = p;
+            }
+        }
+        if(!oldest)
+        {
+            break;
+        }
+        if(oldest->config || !isInFlight(oldest->msgClass, oldest->msgID))
+        {
+            if(pollsInFlight() >= MAX_POLLS_IN_FLIGHT)
+            {
+                break;
+            }
+            if(oldest->config && oldest->frame)
+            {
+                sendFrame(oldest->frame, UBXRATEFRAME<0, 0, 0>::length);
+                configInFlight = true;
+            }
+            else if(oldest->config)
+            {
+                sendMessageRate(oldest->msgClass, oldest->msgID, oldest->rate);
+                configInFlight = true;
+            }
+            else
+            {
+                pollMessage(oldest->msgClass, oldest->msgID);
+            }
+        }
+        // coalesced requests share the response of the request in flight
+        oldest->state = pollState::inflight;
+        oldest->timestamp = millis();
+    }
+}
+
+// calls the callbacks of all requests answered by the message 
+// periodic messages answer pending requests as well
+void ubGPSTime::completePolls(UBXMESSAGE *message)
+{
+    bool found = false;
+    for(uint8_t i = 0; i < MAX_POLLS; i++)
+    {
+        POLLREQUEST *p = &_polls[i];
+        if(((p->state == pollState::inflight) || (p->state == pollState::queued)) && !p->config &&
+            (p->msgClass == message->msgClass) && (p->msgID == message->msgID))
+        {
+            p->state = pollState::complete;
+            found = true;
+        }
+    }
+    // separate pass, callbacks may queue new requests
+    for(uint8_t i = 0; found && (i < MAX_POLLS); i++)
+    {
+        POLLREQUEST *p = &_polls[i];
+        if(p->state == pollState::complete)
+        {
+            POLLREQUEST request = *p;
+            p->state = pollState::free;
+            if(request.callBack)
+            {
+                request.callBack(request.msgClass, request.msgID, message, request.context);
+            }
+        }
+    }
+}
 
-    message.header1 = UBX_HEADER1;
-    message.header2 = UBX_HEADER2;
-    message.msgClass = msgClass;
-    message.msgID = msgID;
-    message.payloadLength = 0;
-    message.payload = 0;
-    sendMessage(&message);      
+// completes the message rate configuration in flight with an ACK/NACK message
+// ACKs only name the acknowledged CFG message, servicePolls() sends one configuration at a time
+void ubGPSTime::completeConfig(UBXMESSAGE *message)
+{
+    if((message->payloadLength < 2) || 
+        (message->payload[0] != UBX_CFG) || (message->payload[1] != UBX_CFG_MSG))
+    {
+        return;
+    }
+    POLLREQUEST *config = nullptr;
+    for(uint8_t i = 0; i < MAX_POLLS; i++)
+    {
+        if((_polls[i].state == pollState::inflight) && _polls[i].config)
+        {
+            config = &_polls[i];
+            break;
+        }
+    }
+    if(config)
+    {
+        POLLREQUEST request = *config;
+        config->state = pollState::free;
+        if(request.callBack)
+        {
+            request.callBack(request.msgClass, request.msgID, message, request.context);
+        }
+    }
 }
 
 // callback message notification
 void ubGPSTime::onMessageEvent(UBXMESSAGE *message)
 {
+#if UBGPS_CALLBACKS
     if(_notify)
     {
         _notify(message);
     }
+#else
+    (void) message;
+#endif
 }
 
 // requests module version information
 void ubGPSTime::requestVersion()
 {
-    pollMessage(UBX_MON, UBX_MON_VER);
+    poll(UBX_MON, UBX_MON_VER);
 }
 
+#if UBGPS_NAV_STATUS
 // requests GPS status information
 void ubGPSTime::requestStatus()
 {
-    pollMessage(UBX_NAV, UBX_NAV_STATUS);
+    poll(UBX_NAV, UBX_NAV_STATUS);
 }
+#endif
 
+#if UBGPS_NAV_TIMEUTC
 // request date/time information
 void ubGPSTime::requestTimeUTC()
 {
-    pollMessage(UBX_NAV, UBX_NAV_TIMEUTC);
+    poll(UBX_NAV, UBX_NAV_TIMEUTC);
 }
+#endif
 
+#if UBGPS_NAV_PVT
+// request date/time and GPS status information in a single message
+void ubGPSTime::requestPVT()
+{
+    poll(UBX_NAV, UBX_NAV_PVT);
+}
+#endif
 
+#if UBGPS_NAV_STATUS
 // subscribe to GPS status information
 void ubGPSTime::subscribeGPSStatus(uint8_t rate, bool wait)
 {
     setMessageRate(UBX_NAV, UBX_NAV_STATUS, rate, wait);
 }
+#endif
 
+#if UBGPS_NAV_TIMEUTC
 // subscribe to date/time information
 void ubGPSTime::subscribeTimeUTC(uint8_t rate, bool wait)
 {
     setMessageRate(UBX_NAV, UBX_NAV_TIMEUTC, rate, wait);
 }
+#endif
+
+#if UBGPS_NAV_PVT
+// subscribe to date/time and GPS status information in a single message
+// NAV-STATUS and NAV-TIMEUTC are redundant then and will be turned off 
+void ubGPSTime::subscribePVT(uint8_t rate, bool wait)
+{
+    setMessageRate(UBX_NAV, UBX_NAV_PVT, rate, wait);
+    if(rate)
+    {
+        setMessageRate(UBX_NAV, UBX_NAV_STATUS, 0, wait);
+        setMessageRate(UBX_NAV, UBX_NAV_TIMEUTC, 0, wait);
+    }
+}
+#endif
 
 // processes Ack messages
 void ubGPSTime::onAck(UBXMESSAGE *message)
 {
-    // not checking Ack for now
-    _pending = pending::none;
+    completeConfig(message);
     if(_verbose)
     {
         _debugPort->println("Received ack");
@@ -523,17 +1921,25 @@ void ubGPSTime::onAck(UBXMESSAGE *message)
 // processes Nack messages
 void ubGPSTime::onNack(UBXMESSAGE *message)
 {
-    // not checking Nack for now
-    _pending = pending::none;
+    completeConfig(message);
     if(_verbose)
     {
         _debugPort->println("Received nack");
     }
 }
 
+#if UBGPS_NAV_STATUS
 // processes GPS status messages and updates internal data structure
 void ubGPSTime::onStatus(UBXMESSAGE *message)
 {
+    if(message->payloadLength < UBX_NAV_STATUS_LEN)
+    {
+        if(_verbose)
+        {
+            _debugPort->println("Message too short");
+        }
+        return;
+    }
     _gpsStatus.timeOfWeek = getU4(message, 0);
     _gpsStatus.gpsFixType = getU1(message, 4);
     _gpsStatus.gpsFixOk = getFlag(message, 5, 0);
@@ -541,6 +1947,7 @@ void ubGPSTime::onStatus(UBXMESSAGE *message)
     _gpsStatus.timeOfWeekValid = getFlag(message, 5, 2);
     _gpsStatus.weekNumberValid = getFlag(message, 5, 3);
     _gpsStatus.timestamp = millis();
+    _gpsStatus.rxTimestamp = message->rxTimestamp;
     if(_verbose)
     {
         _debugPort->print("Time of week:        ");
@@ -557,28 +1964,48 @@ void ubGPSTime::onStatus(UBXMESSAGE *message)
         _debugPort->println(_gpsStatus.weekNumberValid);
     }
 }
+#endif
 
 // processes module version messages and updates internal data structure
 void ubGPSTime::onVersion(UBXMESSAGE *message)
 {
-    uint16_t offset = 0;
-    _moduleVersion.swVersion = getString(message, offset, 30);
-    offset += 30;
-    _moduleVersion.hwVersion = getString(message, offset, 10);
-    offset += 10;
-    for(uint8_t i=0; i < MAX_EXTENSIONS; i++ )
+    if(message->payloadLength < UBX_MON_VER_LEN)
     {
-        if(message->payloadLength >= offset + EXTENSION_LEN)
+        if(_verbose)
         {
-            _moduleVersion.extensions[i] = getString(message, offset, EXTENSION_LEN);
-            offset += EXTENSION_LEN;
+            _debugPort->println("Message too short");
         }
-        else
+        return;
+    }
+#if UBGPS_MODULEVERSION
+    uint16_t offset = 0;
+    uint8_t count = 0;
+    char extension[EXTENSION_LEN + 1];
+
+    getString(message, offset, SWVERSION_LEN, _moduleVersion.swVersion);
+    offset += SWVERSION_LEN;
+    getString(message, offset, HWVERSION_LEN, _moduleVersion.hwVersion);
+    offset += HWVERSION_LEN;
+    memset(&_moduleCaps, 0, sizeof(_moduleCaps));
+    // decode all extensions, store the first MAX_EXTENSIONS
+    while(message->payloadLength >= offset + EXTENSION_LEN)
+    {
+        getString(message, offset, EXTENSION_LEN, extension);
+        offset += EXTENSION_LEN;
+        decodeExtension(extension);
+        if(count < MAX_EXTENSIONS)
         {
-            _moduleVersion.extensions[i]="N/A";
-        }       
+            memcpy(_moduleVersion.extensions[count], extension, sizeof(extension));
+            count++;
+        }
+    }
+    for(uint8_t i = count; i < MAX_EXTENSIONS; i++ )
+    {
+        copyString(_moduleVersion.extensions[i], "N/A", EXTENSION_LEN);
     }
+#endif
     _pending = pending::none;
+#if UBGPS_MODULEVERSION
     if(_verbose)
     {
         _debugPort->print("Software version: ");
@@ -590,12 +2017,26 @@ void ubGPSTime::onVersion(UBXMESSAGE *message)
             _debugPort->printf("Extension %u: ",i+1);
             _debugPort->println(_moduleVersion.extensions[i]);
         }
+        _debugPort->printf("Protocol version: %u\n", _moduleCaps.protocolVersion);
+        _debugPort->printf("Firmware: %s %u\n", _moduleCaps.firmwareType, _moduleCaps.firmwareVersion);
+        _debugPort->printf("Module: %s\n", _moduleCaps.moduleName);
+        _debugPort->printf("GNSS: 0x%02X\n", _moduleCaps.gnss);
     }
+#endif
 }
 
+#if UBGPS_NAV_TIMEUTC
 // processes date/time messages and updates data structure
 void ubGPSTime::onTimeUTC(UBXMESSAGE *message)
 {
+    if(message->payloadLength < UBX_NAV_TIMEUTC_LEN)
+    {
+        if(_verbose)
+        {
+            _debugPort->println("Message too short");
+        }
+        return;
+    }
     _timeUTC.timeOfWeek = getU4(message, 0);
     _timeUTC.accuracy = getU4(message, 4);
     _timeUTC.nanoSecond = getI4(message, 8);
@@ -609,6 +2050,13 @@ void ubGPSTime::onTimeUTC(UBXMESSAGE *message)
     _timeUTC.weekNumberValid = (bool) getFlag(message, 19, 1);
     _timeUTC.utcValid = (bool) getFlag(message, 19, 2);
     _timeUTC.timestamp = millis();
+    _timeUTC.rxTimestamp = message->rxTimestamp;
+#if UBGPS_TIMING
+    addTimingSample(_timeUTC);
+#endif
+#if UBGPS_SECOND
+    updateSecond(_timeUTC);
+#endif
     if(_verbose)
     {
         _debugPort->print("Time of week:       ");
@@ -637,18 +2085,98 @@ void ubGPSTime::onTimeUTC(UBXMESSAGE *message)
         _debugPort->println(_timeUTC.utcValid);
         _debugPort->print("Timestamp:          ");
         _debugPort->println(_timeUTC.timestamp);
+        _debugPort->print("RX timestamp (us):  ");
+        _debugPort->println(_timeUTC.rxTimestamp);
     }
 }
+#endif
+
+#if UBGPS_NAV_PVT
+// processes navigation position velocity time solution messages
+// updates date/time and GPS status information from the same navigation epoch
+void ubGPSTime::onPVT(UBXMESSAGE *message)
+{
+    if(message->payloadLength < UBX_NAV_PVT_LEN)
+    {
+        if(_verbose)
+        {
+            _debugPort->println("Message too short");
+        }
+        return;
+    }
+    uint32_t timestamp = millis();
+    bool validDate = (bool) getFlag(message, 11, 0);
+    bool validTime = (bool) getFlag(message, 11, 1);
+    bool fullyResolved = (bool) getFlag(message, 11, 2);
+
+    _timeUTC.timeOfWeek = getU4(message, 0);
+    _timeUTC.year = getU2(message, 4);
+    _timeUTC.month = getU1(message, 6);
+    _timeUTC.day = getU1(message, 7);
+    _timeUTC.hour = getU1(message, 8);
+    _timeUTC.minute = getU1(message, 9);
+    _timeUTC.second = getU1(message, 10);
+    _timeUTC.accuracy = getU4(message, 12);
+    _timeUTC.nanoSecond = getI4(message, 16);
+    _timeUTC.timeOfWeekValid = validTime;
+    _timeUTC.weekNumberValid = validDate;
+    _timeUTC.utcValid = validDate && validTime && fullyResolved;
+    _timeUTC.timestamp = timestamp;
+    _timeUTC.rxTimestamp = message->rxTimestamp;
+#if UBGPS_TIMING
+    addTimingSample(_timeUTC);
+#endif
+#if UBGPS_SECOND
+    updateSecond(_timeUTC);
+#endif
+
+    _gpsStatus.timeOfWeek = _timeUTC.timeOfWeek;
+    _gpsStatus.gpsFixType = getU1(message, 20);
+    _gpsStatus.gpsFixOk = getFlag(message, 21, 0);
+    _gpsStatus.diffApplied = getFlag(message, 21, 1);
+    _gpsStatus.timeOfWeekValid = validTime;
+    _gpsStatus.weekNumberValid = validDate;
+    _gpsStatus.timestamp = timestamp;
+    _gpsStatus.rxTimestamp = message->rxTimestamp;
+    if(_verbose)
+    {
+        _debugPort->print("PVT time of week:   ");
+        _debugPort->println(_timeUTC.timeOfWeek);
+        _debugPort->printf("PVT date/time:      %04u-%02u-%02u %02u:%02u:%02u\n",
+            _timeUTC.year, _timeUTC.month, _timeUTC.day,
+            _timeUTC.hour, _timeUTC.minute, _timeUTC.second);
+        _debugPort->print("PVT nanoseconds:    ");
+        _debugPort->println(_timeUTC.nanoSecond);
+        _debugPort->print("PVT accuracy:       ");
+        _debugPort->println(_timeUTC.accuracy);
+        _debugPort->print("PVT UTC valid:      ");
+        _debugPort->println(_timeUTC.utcValid);
+        _debugPort->print("PVT GPS fix type:   ");
+        _debugPort->println(_gpsStatus.gpsFixType);
+        _debugPort->print("PVT GPS fix OK:     ");
+        _debugPort->println(_gpsStatus.gpsFixOk);
+    }
+}
+#endif
 
 // field extraction functions
+// fields outside of the received payload read as 0
 uint8_t ubGPSTime::getU1(UBXMESSAGE *message, uint16_t offset)
 {
+    if(!message->payload || ((uint32_t) offset + 1 > message->payloadLength))
+    {
+        return (0);
+    }
     return (uint8_t)message->payload[offset];
 }
 
 uint16_t ubGPSTime::getU2(UBXMESSAGE *message, uint16_t offset)
 {
   uint16_t value = 0;
+  if(!message->payload || ((uint32_t) offset + 2 > message->payloadLength))
+  {
+    return (0);
+  }
   value |= (uint16_t)message->payload[offset];
   value |= (uint16_t)message->payload[offset + 1] << 8;
   return (value);
@@ -657,6 +2185,10 @@ uint16_t ubGPSTime::getU2(UBXMESSAGE *message, uint16_t offset)
 uint32_t ubGPSTime::getU4(UBXMESSAGE *message, uint16_t offset)
 {
   uint32_t value = 0;
+  if(!message->payload || ((uint32_t) offset + 4 > message->payloadLength))
+  {
+    return (0);
+  }
   value |= (uint32_t)message->payload[offset];
   value |= (uint32_t)message->payload[offset + 1] << 8;
   value |= (uint32_t)message->payload[offset + 2] << 16;
@@ -675,20 +2207,106 @@ uint8_t ubGPSTime::getFlag(UBXMESSAGE *message, uint16_t offset, uint8_t bit)
     return ((flags >> bit) & 0x01);
 }
 
-String ubGPSTime::getString(UBXMESSAGE *message, uint16_t offset, uint16_t length)
+#if UBGPS_MODULEVERSION
+// copies a zero terminated string field, buffer must hold length + 1 chars
+// the string ends at the end of the payload
+void ubGPSTime::getString(UBXMESSAGE *message, uint16_t offset, uint16_t length, char *buffer)
 {
-    String s;
-    for(uint16_t i = offset; i < offset + length; i++)
+    uint16_t i = 0;
+    for(; i < length; i++)
     {
-        if(message->payload[i]!= 0)
-        {
-            s += (char) message->payload[i];
-        }
-        else
+        if(!message->payload || ((uint32_t) offset + i >= message->payloadLength) || 
+            (message->payload[offset + i] == 0))
         {
             break;
         }
+        buffer[i] = (char) message->payload[offset + i];
+    }
+    buffer[i] = 0;
+}
+
+// copies a string, buffer must hold length + 1 chars
+void ubGPSTime::copyString(char *buffer, const char *s, uint16_t length)
+{
+    uint16_t i = 0;
+    for(; (i < length) && s[i]; i++)
+    {
+        buffer[i] = s[i];
+    }
+    buffer[i] = 0;
+}
+
+// parses "major.minor" into major * 100 + minor, e.g. "18.00" -> 1800
+uint16_t ubGPSTime::parseVersion(const char *s)
+{
+    char *end;
+    uint16_t version = (uint16_t) strtoul(s, &end, 10) * 100;
+    if(*end == '.')
+    {
+        version += (uint16_t) strtoul(end + 1, nullptr, 10) % 100;
     }
-    return (s);        
+    return (version);
 }
 
+// decodes a single version extension line
+// e.g. "PROTVER=18.00", "FWVER=SPG 3.01", "MOD=NEO-M8N", "GPS;GLO;GAL;BDS"
+void ubGPSTime::decodeExtension(const char *extension)
+{
+    if(strncmp(extension, "PROTVER=", 8) == 0)
+    {
+        _moduleCaps.protocolVersion = parseVersion(extension + 8);
+    }
+    else if(strncmp(extension, "PROTVER ", 8) == 0)
+    {
+        // older firmware uses a blank instead of '='
+        _moduleCaps.protocolVersion = parseVersion(extension + 8);
+    }
+    else if(strncmp(extension, "FWVER=", 6) == 0)
+    {
+        const char *version = strchr(extension + 6, ' ');
+        uint16_t length = version ? version - (extension + 6) : strlen(extension + 6);
+        copyString(_moduleCaps.firmwareType, extension + 6, 
+            length < FIRMWARE_TYPE_LEN ? length : FIRMWARE_TYPE_LEN);
+        if(version)
+        {
+            _moduleCaps.firmwareVersion = parseVersion(version + 1);
+        }
+    }
+    else if(strncmp(extension, "MOD=", 4) == 0)
+    {
+        copyString(_moduleCaps.moduleName, extension + 4, MODULE_NAME_LEN);
+    }
+    else if(!strchr(extension, '='))
+    {
+        // list of supported GNSS, separated by ';'
+        static const struct
+        {
+            const char *name;
+            uint8_t flag;
+        }
+        gnssNames[] = 
+        {
+            {"GPS", GNSS_GPS}, {"SBAS", GNSS_SBAS}, {"GAL", GNSS_GAL}, {"BDS", GNSS_BDS},
+            {"IMES", GNSS_IMES}, {"QZSS", GNSS_QZSS}, {"GLO", GNSS_GLO}
+        };
+        const char *token = extension;
+        while(*token)
+        {
+            const char *end = strchr(token, ';');
+            uint16_t length = end ? end - token : strlen(token);
+            for(uint8_t i = 0; i < sizeof(gnssNames) / sizeof(gnssNames[0]); i++)
+            {
+                if((strlen(gnssNames[i].name) == length) && (strncmp(token, gnssNames[i].name, length) == 0))
+                {
+                    _moduleCaps.gnss |= gnssNames[i].flag;
+                }
+            }
+            token += length;
+            if(*token == ';')
+            {
+                token++;
+            }
+        }
+    }
+}
+#endif
@@ -30,9 +30,80 @@
 #define INIT_STEPS  1 // only one init step for now
 #define WAIT_FOR_RESPONSE 5000 // 5 seconds
 
+// feature selection, set to 0 in the build flags to leave features out of small builds
+#ifndef UBGPS_VERBOSE
+#define UBGPS_VERBOSE 1 // debug output, enableVerbose()
+#endif
+#ifndef UBGPS_MODULEVERSION
+#define UBGPS_MODULEVERSION 1 // module version strings and capabilities
+#endif
+#ifndef UBGPS_CALLBACKS
+#define UBGPS_CALLBACKS 1 // message notification, attach()
+#endif
+#ifndef UBGPS_CHUNKED
+#define UBGPS_CHUNKED 1 // payloads larger than MAX_PAYLOAD, attachChunked()
+#endif
+#ifndef UBGPS_RECOVERY
+#define UBGPS_RECOVERY 1 // receiver reset detection and configuration recovery
+#endif
+#ifndef UBGPS_TIMING
+#define UBGPS_TIMING 1 // timing quality statistics of NAV-TIMEUTC arrivals
+#endif
+#ifndef UBGPS_SECOND
+#define UBGPS_SECOND 1 // top of second callback, onSecond()
+#endif
+#ifndef UBGPS_NAV_STATUS
+#define UBGPS_NAV_STATUS 1
+#endif
+#ifndef UBGPS_NAV_TIMEUTC
+#define UBGPS_NAV_TIMEUTC 1
+#endif
+#ifndef UBGPS_NAV_PVT
+#define UBGPS_NAV_PVT 1
+#endif
+
+#ifndef MAX_PAYLOAD
 #define MAX_PAYLOAD 512
+#endif
 #define MAX_EXTENSIONS 4
 #define EXTENSION_LEN 30
+#define SWVERSION_LEN 30
+#define HWVERSION_LEN 10
+#define MODULE_NAME_LEN 15
+#define FIRMWARE_TYPE_LEN 7
+#ifndef MAX_POLLS
+#define MAX_POLLS 8 // queued and in flight poll requests
+#endif
+#define MAX_POLLS_IN_FLIGHT 3 // the gps module discards requests if too many are sent in a row
+#define POLL_TIMEOUT 1000 // 1 second
+#define UBX_FRAME_OVERHEAD 8 // header, class, id, length and checksum
+#define TX_FRAME_PAYLOAD 32 // frames up to this payload size are sent with a single write
+#ifndef TX_QUEUE_SIZE
+#define TX_QUEUE_SIZE 128 // default size of the optional transmit queue
+#endif
+#ifndef MAX_FILTERS
+#define MAX_FILTERS 8 // accepted messages if the message filter is enabled
+#endif
+#ifndef CHUNK_SIZE
+#define CHUNK_SIZE 64 // buffer for payloads larger than MAX_PAYLOAD delivered in chunks
+#endif
+#ifndef MAX_CONFIG
+#define MAX_CONFIG 12 // message rates restored after a receiver reset
+#endif
+#ifndef TIMING_HISTORY
+#define TIMING_HISTORY 32 // samples kept for the Allan deviation
+#endif
+#ifndef SECOND_LATENCY
+#define SECOND_LATENCY 0 // us from the navigation epoch to the first byte of NAV-TIMEUTC, calibrate with PPS
+#endif
+#define SECOND_HOLDOVER 3 // seconds ticked without a new NAV-TIMEUTC
+#define RESET_GUARD 2000 // ms after a configuration change before resets are detected
+#define RESET_NMEA_SENTENCES 2 // complete NMEA sentences while NMEA is disabled
+#define RESET_NMEA_WINDOW 2000 // ms, the sentences have to arrive within this time
+#define NMEA_MAX_LENGTH 82 // including $, checksum and CR LF
+#define RESET_NAV_GAP 3 // missed NAV updates
+#define RESTORE_RETRY 1000 // ms between restore attempts if the receiver does not answer
+#define UART_BITS_PER_BYTE 10 // 8N1: start bit, 8 data bits, stop bit
 
 // UBX headers
 const uint8_t UBX_HEADER1 = 0xB5;
@@ -62,12 +133,71 @@ const uint8_t UBX_MON_VER = 0x04;
 
 // UBX NAV
 const uint8_t UBX_NAV_STATUS = 0x03;
+const uint8_t UBX_NAV_PVT = 0x07;
 const uint8_t UBX_NAV_TIMEUTC = 0x21;
 
 // ACK/NACK
 const uint8_t UBX_ACK_NACK = 0x00;
 const uint8_t UBX_ACK_ACK = 0x01;
 
+// minimum payload lengths, shorter messages are ignored
+const uint16_t UBX_MON_VER_LEN = 40; // software and hardware version, extensions are optional
+const uint16_t UBX_NAV_STATUS_LEN = 16;
+const uint16_t UBX_NAV_PVT_LEN = 92;
+const uint16_t UBX_NAV_TIMEUTC_LEN = 20;
+
+// compile-time UBX frames
+// checksum A and B over class, id, length and payload (8-bit Fletcher)
+constexpr uint8_t ubxChecksumA()
+{
+    return (0);
+}
+
+template<typename... T>
+constexpr uint8_t ubxChecksumA(uint8_t value, T... values)
+{
+    return ((uint8_t)(value + ubxChecksumA(values...)));
+}
+
+constexpr uint8_t ubxChecksumB()
+{
+    return (0);
+}
+
+// each byte is added to B once for every byte following it, plus once for itself
+template<typename... T>
+constexpr uint8_t ubxChecksumB(uint8_t value, T... values)
+{
+    return ((uint8_t)((sizeof...(values) + 1) * value + ubxChecksumB(values...)));
+}
+
+// complete frame including headers and checksum, body is class, id, length and payload
+// placed in flash on ARM/ESP targets, AVR copies constant data to RAM
+template<uint8_t... body>
+struct UBXFRAME
+{
+    static constexpr uint16_t length = sizeof...(body) + 4;
+    static constexpr uint8_t data[sizeof...(body) + 4] = 
+        { UBX_HEADER1, UBX_HEADER2, body..., ubxChecksumA(body...), ubxChecksumB(body...) };
+};
+
+template<uint8_t... body>
+constexpr uint8_t UBXFRAME<body...>::data[];
+
+// poll request without payload
+template<uint8_t msgClass, uint8_t msgID>
+using UBXPOLLFRAME = UBXFRAME<msgClass, msgID, 0, 0>;
+
+// message rate configuration (CFG-MSG)
+template<uint8_t msgClass, uint8_t msgID, uint8_t rate>
+using UBXRATEFRAME = UBXFRAME<UBX_CFG, UBX_CFG_MSG, 3, 0, msgClass, msgID, rate>;
+
+static_assert(UBXPOLLFRAME<UBX_MON, UBX_MON_VER>::data[6] == 0x0E && 
+    UBXPOLLFRAME<UBX_MON, UBX_MON_VER>::data[7] == 0x34, "UBX checksum");
+static_assert(UBXRATEFRAME<UBX_NMEA, UBX_NMEA_GGA, 0>::data[9] == 0xFA && 
+    UBXRATEFRAME<UBX_NMEA, UBX_NMEA_GGA, 0>::data[10] == 0x0F, "UBX checksum");
+static_assert(TIMING_HISTORY >= 3 && TIMING_HISTORY <= 255, "TIMING_HISTORY out of range");
+
 // UBX message
 typedef struct
 {
@@ -79,9 +209,41 @@ typedef struct
     uint8_t *payload;
     uint8_t CK_A;
     uint8_t CK_B;
+    uint32_t rxTimestamp; // micros() at start of frame, transit compensated
 }
 UBXMESSAGE;
 
+// message rate configured on the receiver
+typedef struct
+{
+    uint8_t msgClass;
+    uint8_t msgID;
+    uint8_t rate;
+    bool applied;
+}
+RATECONFIG;
+
+// receiver reset detection and recovery
+typedef struct
+{
+    uint32_t resets;
+    uint32_t detected; // millis() of the last detected reset
+    uint32_t recoveryTime; // ms from detection until the configuration was restored
+    uint32_t junkBytes; // bytes outside of UBX frames since the last detected reset
+    uint32_t resetJunkBytes; // junk bytes up to the last detection, e.g. the NMEA banner of a reboot
+    bool recovering;
+}
+RECOVERYSTATS;
+
+// accepted message
+typedef struct
+{
+    uint8_t msgClass;
+    uint8_t msgID;
+    bool anyID;
+}
+MESSAGEFILTER;
+
 // date/time information
 typedef struct 
 {
@@ -98,6 +260,7 @@ typedef struct
     bool timeOfWeekValid;
     bool weekNumberValid;
     uint32_t timestamp;
+    uint32_t rxTimestamp;
 }
 TIMEUTC;
 
@@ -111,18 +274,77 @@ typedef struct
     bool timeOfWeekValid;
     bool weekNumberValid;
     uint32_t timestamp;
+    uint32_t rxTimestamp;
 }
 GPSSTATUS;
 
+// arrival of a time message
+typedef struct
+{
+    uint32_t rxTimestamp; // micros() of the frame header
+    uint32_t timeOfWeek; // ms, GPS time of the navigation epoch
+    uint32_t accuracy; // ns
+}
+TIMINGSAMPLE;
+
+// arrival timing against GPS time, error = local interval - GPS interval between consecutive epochs
+typedef struct
+{
+    uint32_t samples; // intervals included
+    uint32_t gaps; // missed epochs, rate changes and week rollovers, the history restarts
+    uint32_t interval; // ms between epochs
+    float meanError; // us per interval, local clock rate against GPS
+    float stdDev; // us, arrival jitter including the serial latency
+    float drift; // ppm, meanError relative to the interval
+    int32_t minError; // us
+    int32_t maxError; // us
+    float meanAccuracy; // ns, reported by the receiver
+}
+TIMINGSTATS;
+
+// top of second scheduling
+typedef struct
+{
+    uint32_t ticks;
+    uint32_t missed; // seconds passed while process() was not called
+    uint32_t holdover; // ticks predicted from a NAV-TIMEUTC older than one second
+    int32_t lateness; // us, callback after the predicted second boundary
+    int32_t maxLateness; // us
+    int32_t residual; // us, new second boundary - boundary predicted from the previous message
+    int32_t maxResidual; // us, absolute
+}
+SECONDSTATS;
+
+// supported GNSS flags
+const uint8_t GNSS_GPS = 0x01;
+const uint8_t GNSS_SBAS = 0x02;
+const uint8_t GNSS_GAL = 0x04;
+const uint8_t GNSS_BDS = 0x08;
+const uint8_t GNSS_IMES = 0x10;
+const uint8_t GNSS_QZSS = 0x20;
+const uint8_t GNSS_GLO = 0x40;
+
 // GPS module information
 typedef struct 
 {
-    String swVersion;
-    String hwVersion;
-    String extensions[MAX_EXTENSIONS];
+    char swVersion[SWVERSION_LEN + 1];
+    char hwVersion[HWVERSION_LEN + 1];
+    char extensions[MAX_EXTENSIONS][EXTENSION_LEN + 1];
 }
 MODULEVERSION;
 
+// GPS module capabilities decoded from the version extensions
+// versions are major * 100 + minor (PROTVER=18.00 -> 1800), 0 if unknown
+typedef struct 
+{
+    uint16_t protocolVersion;
+    uint16_t firmwareVersion;
+    char firmwareType[FIRMWARE_TYPE_LEN + 1];
+    char moduleName[MODULE_NAME_LEN + 1];
+    uint8_t gnss; 
+}
+MODULECAPS;
+
 // checksums
 typedef struct 
 {
@@ -131,6 +353,21 @@ typedef struct
 }
 CHECKSUM;
 
+// part of a payload larger than MAX_PAYLOAD
+typedef struct
+{
+    uint8_t msgClass;
+    uint8_t msgID;
+    uint16_t payloadLength; // total payload length
+    uint16_t offset; // position of data within the payload
+    uint16_t length; // number of bytes in data
+    const uint8_t *data;
+    CHECKSUM checksum; // running checksum up to the end of data
+    bool valid; // end event only, checksum matches
+    uint32_t rxTimestamp;
+}
+PAYLOADCHUNK;
+
 // enums
 enum class direction
 {
@@ -145,71 +382,315 @@ enum class pending
     ack
 };
 
+enum class chunkEvent
+{
+    begin,
+    data,
+    end
+};
+
+enum class pollState
+{
+    free,
+    queued,
+    inflight,
+    complete
+};
+
 class ubGPSTime
 {
 
 protected:
     using notifyCallBack = void (*)(UBXMESSAGE *message);
+    // begin: return false to skip the message, data: next chunk, end: checksum result
+    using chunkCallBack = bool (*)(chunkEvent event, PAYLOADCHUNK *chunk, void *context);
+    // message is nullptr if the request timed out
+    using pollCallBack = void (*)(uint8_t msgClass, uint8_t msgID, UBXMESSAGE *message, void *context);
+    // time of the second that just started, nanoSecond is 0
+    using secondCallBack = void (*)(TIMEUTC *time);
+
+    // poll request
+    typedef struct
+    {
+        uint8_t msgClass;
+        uint8_t msgID;
+        pollState state;
+        uint32_t timestamp;
+        uint32_t timeout;
+        pollCallBack callBack;
+        void *context;
+        bool config; // message rate configuration, completed by ACK/NACK
+        uint8_t rate;
+        const uint8_t *frame; // precomputed CFG-MSG frame or nullptr
+    }
+    POLLREQUEST;
 
 public:
     ubGPSTime();
+    ~ubGPSTime();
+    // owns the payload buffer and the transmit queue
+    ubGPSTime(const ubGPSTime &) = delete;
+    ubGPSTime &operator=(const ubGPSTime &) = delete;
 
+#if UBGPS_CALLBACKS
     void attach(notifyCallBack callBack);
     void detach();
+#endif
+
+#if UBGPS_CHUNKED
+    // receives messages with payloads larger than MAX_PAYLOAD in chunks of CHUNK_SIZE bytes
+    // polls for these messages complete with payloadLength 0 and no payload after the end event
+    void attachChunked(chunkCallBack callBack, void *context = nullptr);
+    void detachChunked();
+#endif
 
     void initialize();
-    void begin(Stream &serialPort);
+    void begin(Stream &serialPort, uint32_t baudRate = 0);
+    void setBaudRate(uint32_t baudRate);
 
     void enableVerbose(Stream &debugPort = Serial);
     void disableVerbose();
 
+    // message filter, frames of other messages are skipped without buffering
+    // ACK/NACK and messages with pending requests are always accepted
+    void enableFilter();
+    void disableFilter();
+    bool acceptMessage(uint8_t msgClass, uint8_t msgID);
+    bool acceptClass(uint8_t msgClass);
+    void clearFilter();
+    uint32_t getSkippedFrames();
+
+    void enableTxQueue(uint16_t size = TX_QUEUE_SIZE);
+    void disableTxQueue();
+
     void process();
     void sendMessage(UBXMESSAGE *message);
+    void sendFrame(const uint8_t *frame, uint16_t length);
 
     void disableDefaultNMEA();
 
     void setMessageRate(uint8_t msgClass, uint8_t msgID, uint8_t rate, bool wait = true);
+    bool setMessageRate(uint8_t msgClass, uint8_t msgID, uint8_t rate, pollCallBack callBack, 
+        void *context = nullptr, uint32_t timeout = POLL_TIMEOUT);
     void pollMessage(uint8_t msgClass, uint8_t msgID);
+    bool poll(uint8_t msgClass, uint8_t msgID, pollCallBack callBack = nullptr, 
+        void *context = nullptr, uint32_t timeout = POLL_TIMEOUT);
+    uint8_t getPendingPolls();
 
     // single request
     void requestVersion();
+#if UBGPS_NAV_STATUS
     void requestStatus();
+#endif
+#if UBGPS_NAV_TIMEUTC
     void requestTimeUTC();   
+#endif
+#if UBGPS_NAV_PVT
+    void requestPVT();
+#endif
 
     // subscriptions
+#if UBGPS_NAV_STATUS
     void subscribeGPSStatus(uint8_t rate, bool wait = true);
+#endif
+#if UBGPS_NAV_TIMEUTC
     void subscribeTimeUTC(uint8_t rate, bool wait = true);
+#endif
+#if UBGPS_NAV_PVT
+    void subscribePVT(uint8_t rate, bool wait = true);
+#endif
 
-    MODULEVERSION getModuleVersion();
+#if UBGPS_MODULEVERSION
+    const MODULEVERSION &getModuleVersion();
+    const MODULECAPS &getModuleCaps();
+#endif
     TIMEUTC getTimeUTC();
     GPSSTATUS getGPSStatus();
     bool isInitialized();
+    uint32_t getTransitTime(uint16_t bytes);
+
+#if UBGPS_RECOVERY
+    // power-cycled receivers lose their configuration, it is restored in the background
+    void enableRecovery();
+    void disableRecovery();
+    const RECOVERYSTATS &getRecoveryStats();
+#endif
+
+#if UBGPS_SECOND
+    // callback at the start of each UTC second, predicted from NAV-TIMEUTC (or NAV-PVT)
+    // fired from process(), call it in a tight loop. nullptr stops the callback
+    void onSecond(secondCallBack callBack, int32_t latency = SECOND_LATENCY);
+    // us until the next second boundary, -1 if unknown (e.g. to arm a hardware timer)
+    int32_t getMicrosToSecond();
+    const SECONDSTATS &getSecondStats();
+#endif
+
+#if UBGPS_TIMING
+    // timing quality of NAV-TIMEUTC (or NAV-PVT) arrivals
+    const TIMINGSTATS &getTimingStats();
+    void resetTimingStats();
+    // age 0 is the latest sample, nullptr if not available
+    const TIMINGSAMPLE *getTimingSample(uint8_t age);
+    uint8_t getTimingSamples();
+    // fractional frequency stability for tau = n epochs, 0 if the history is too short (2n + 1 samples)
+    float getAllanDeviation(uint8_t n);
+#endif
 
 private:
     Stream *_serialPort;
+    uint32_t _baudRate;
     Stream *_debugPort;
+#if UBGPS_VERBOSE
     bool _verbose;
+#else
+    // constant, the compiler drops all debug output
+    static const bool _verbose = false;
+#endif
     bool _initialized;
     pending _pending;
+#if UBGPS_CALLBACKS
     notifyCallBack _notify;
+#endif
     TIMEUTC _timeUTC;
     GPSSTATUS _gpsStatus;
+#if UBGPS_MODULEVERSION
     MODULEVERSION _moduleVersion;
+    MODULECAPS _moduleCaps;
+#endif
+    POLLREQUEST _polls[MAX_POLLS];
+    UBXMESSAGE _message;
+    uint16_t _fieldCounter;
+    uint16_t _payloadCounter;
+    MESSAGEFILTER _filters[MAX_FILTERS];
+    uint8_t _filterCount;
+    bool _filterEnabled;
+    uint32_t _skippedFrames;
+#if UBGPS_CHUNKED
+    chunkCallBack _chunkNotify;
+    void *_chunkContext;
+    PAYLOADCHUNK _chunk;
+    bool _streaming;
+#endif
+    RATECONFIG _config[MAX_CONFIG];
+    uint8_t _configCount;
+    uint32_t _configTimestamp;
+#if UBGPS_RECOVERY
+    bool _recoveryEnabled;
+    bool _restoring;
+    uint32_t _restoreTimestamp;
+    RECOVERYSTATS _recovery;
+    uint32_t _navTimestamp;
+    uint8_t _nmeaSentences;
+    uint32_t _nmeaTimestamp; // first sentence in the current window
+    uint8_t _nmeaState;
+    uint8_t _nmeaLength;
+    uint8_t _nmeaChecksum;
+#endif
+#if UBGPS_TIMING
+    TIMINGSAMPLE _timing[TIMING_HISTORY];
+    uint8_t _timingHead;
+    uint8_t _timingCount;
+    uint32_t _timingInterval;
+    TIMINGSTATS _timingStats;
+    float _timingM2;
+#endif
+#if UBGPS_SECOND
+    secondCallBack _secondNotify;
+    int32_t _secondLatency;
+    bool _secondAnchored;
+    TIMEUTC _secondAnchor; // last valid time message
+    uint32_t _secondBoundary; // micros() at the start of the anchor second
+    uint32_t _nextSecond; // micros() at the next boundary
+    TIMEUTC _nextTime;
+    bool _secondFired;
+    uint32_t _lastLabel; // second of day of the last tick fired
+    SECONDSTATS _secondStats;
+#endif
+    uint8_t *_txQueue;
+    uint16_t _txQueueSize;
+    uint16_t _txHead;
+    uint16_t _txCount;
+
+    // message filter
+    bool isAccepted(uint8_t msgClass, uint8_t msgID);
+    bool addFilter(uint8_t msgClass, uint8_t msgID, bool anyID);
+
+#if UBGPS_CHUNKED
+    // chunked payloads
+    bool beginChunks();
+    void addChunkByte(uint8_t value);
+    void endChunks();
+#endif
+
+    // receiver reset detection
+    void recordRate(uint8_t msgClass, uint8_t msgID, uint8_t rate);
+#if UBGPS_RECOVERY
+    void checkJunk(uint8_t value);
+    bool scanNMEA(uint8_t value);
+    void checkNavGap();
+    void onReset();
+    void restoreConfig();
+    static void onRestoreResponse(uint8_t msgClass, uint8_t msgID, UBXMESSAGE *message, void *context);
+#endif
+    bool queueMessageRate(uint8_t msgClass, uint8_t msgID, uint8_t rate, pollCallBack callBack, 
+        void *context, uint32_t timeout, const uint8_t *frame = nullptr);
+    void configureRate(uint8_t msgClass, uint8_t msgID, uint8_t rate, const uint8_t *frame, bool wait);
+    static void onConfigResponse(uint8_t msgClass, uint8_t msgID, UBXMESSAGE *message, void *context);
+    bool isConfigPending();
+
+#if UBGPS_TIMING
+    // timing statistics
+    void addTimingSample(const TIMEUTC &time);
+    int32_t getTimingPhase(uint8_t age);
+#endif
+
+#if UBGPS_SECOND
+    // top of second
+    void updateSecond(const TIMEUTC &time);
+    void serviceSecond();
+    void advanceSecond();
+    void tickTime(TIMEUTC *time);
+    static uint32_t secondOfDay(const TIMEUTC &time);
+#endif
+
+    // transmission
+    void writeBytes(const uint8_t *data, uint16_t length);
+    void drainTxQueue();
+    void flushTxQueue();
+
+    void setFrameByte(uint8_t *frame, uint16_t length, uint16_t index, uint8_t value);
 
     void printMessage(UBXMESSAGE *message, direction dir);
+    void printFrame(const uint8_t *frame, uint16_t length);
     void printHEX(uint8_t value);
 
     // message processing functions
     void onAck(UBXMESSAGE *message);
     void onNack(UBXMESSAGE *message);
-    void onStatus(UBXMESSAGE *message);
     void onVersion(UBXMESSAGE *message);
+#if UBGPS_NAV_STATUS
+    void onStatus(UBXMESSAGE *message);
+#endif
+#if UBGPS_NAV_TIMEUTC
     void onTimeUTC(UBXMESSAGE *message);
+#endif
+#if UBGPS_NAV_PVT
+    void onPVT(UBXMESSAGE *message);
+#endif
 
     void processMessage(UBXMESSAGE *message);
     void onMessageEvent(UBXMESSAGE *message);
     bool waitForResponse(uint32_t timeout);
 
+    // poll scheduler
+    void servicePolls();
+    void completePolls(UBXMESSAGE *message);
+    void completeConfig(UBXMESSAGE *message);
+    POLLREQUEST *allocatePoll();
+    void sendMessageRate(uint8_t msgClass, uint8_t msgID, uint8_t rate);
+    uint8_t pollsInFlight();
+    bool isInFlight(uint8_t msgClass, uint8_t msgID);
+
     // checksum
     void calculateChecksum(UBXMESSAGE *message, CHECKSUM *checksum);
     void stepChecksum(uint8_t value, CHECKSUM *checksum);
@@ -221,7 +702,14 @@ private:
     uint32_t getU4(UBXMESSAGE *message, uint16_t offset);
     int32_t getI4(UBXMESSAGE *message, uint16_t offset);
     uint8_t getFlag(UBXMESSAGE *message, uint16_t offset, uint8_t bit);
-    String getString(UBXMESSAGE *message, uint16_t offset, uint16_t length);
+#if UBGPS_MODULEVERSION
+    void getString(UBXMESSAGE *message, uint16_t offset, uint16_t length, char *buffer);
+
+    // module capability decoding
+    void decodeExtension(const char *extension);
+    uint16_t parseVersion(const char *s);
+    void copyString(char *buffer, const char *s, uint16_t length);
+#endif
 };
 
 #endif
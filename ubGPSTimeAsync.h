@@ -0,0 +1,331 @@
+// ubGPSTime
+// get utc time from u-blox gps module
+// designed for nixie clocks...
+// Version 0.1.3 (alpha)
+
+// MIT license
+// Copyright 2021 highvoltglow
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), to deal in the Software without restriction, 
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, 
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software 
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR 
+// OTHER DEALINGS IN THE SOFTWARE.
+
+// C++20 coroutine interface for Linux host builds
+// awaitable poll requests and message rate configuration, resumed by ubGPSEventLoop
+//
+//   ubGPSTask control(ubGPSAsync &gps)
+//   {
+//       std::optional<TIMEUTC> time = co_await gps.poll<NavTimeUTC>();
+//       bool ok = co_await gps.setRate(UBX_NAV, UBX_NAV_STATUS, 5);
+//   }
+
+#ifndef UBGPSTIMEASYNC_H
+#define UBGPSTIMEASYNC_H
+
+#if defined(__linux__) && (__cplusplus >= 202002L)
+
+#include <algorithm>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <vector>
+#include <poll.h>
+#include <ubGPSTime.h>
+#include <ubGPSLinuxSerial.h>
+
+#define EVENT_LOOP_TICK 10 // ms, upper limit for poll() so that request timeouts are serviced
+
+// message descriptions for poll<>()
+struct NavTimeUTC
+{
+    static constexpr uint8_t msgClass = UBX_NAV;
+    static constexpr uint8_t msgID = UBX_NAV_TIMEUTC;
+    using type = TIMEUTC;
+    static type get(ubGPSTime &gps) { return (gps.getTimeUTC()); }
+};
+
+struct NavStatus
+{
+    static constexpr uint8_t msgClass = UBX_NAV;
+    static constexpr uint8_t msgID = UBX_NAV_STATUS;
+    using type = GPSSTATUS;
+    static type get(ubGPSTime &gps) { return (gps.getGPSStatus()); }
+};
+
+struct NavPVT
+{
+    static constexpr uint8_t msgClass = UBX_NAV;
+    static constexpr uint8_t msgID = UBX_NAV_PVT;
+    using type = TIMEUTC;
+    static type get(ubGPSTime &gps) { return (gps.getTimeUTC()); }
+};
+
+#if UBGPS_MODULEVERSION
+struct MonVersion
+{
+    static constexpr uint8_t msgClass = UBX_MON;
+    static constexpr uint8_t msgID = UBX_MON_VER;
+    using type = MODULECAPS;
+    static type get(ubGPSTime &gps) { return (gps.getModuleCaps()); }
+};
+#endif
+
+// detached coroutine, starts immediately and cleans up when finished
+struct ubGPSTask
+{
+    struct promise_type
+    {
+        ubGPSTask get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+// drives any number of receivers from one thread
+// sleeps in poll() on all serial ports, calls process() and resumes completed coroutines
+class ubGPSEventLoop
+{
+public:
+    void add(ubGPSTime &gps, ubGPSLinuxSerial &port)
+    {
+        _receivers.push_back({ &gps, &port });
+    }
+
+    // coroutines are resumed from the loop, never from inside process()
+    void schedule(std::coroutine_handle<> handle)
+    {
+        _ready.push_back(handle);
+    }
+
+    // submits a request, if the request table of the receiver is full (MAX_POLLS)
+    // it is kept and submitted in order as soon as entries are free
+    void submit(ubGPSTime &gps, std::function<bool()> request)
+    {
+        if(!isDeferred(&gps) && request())
+        {
+            return;
+        }
+        _deferred.push_back({ &gps, request });
+    }
+
+    // waits up to timeout ms for data, processes all receivers and resumes ready coroutines
+    void runOnce(int timeout = EVENT_LOOP_TICK)
+    {
+        std::vector<struct pollfd> fds;
+        for(auto &receiver : _receivers)
+        {
+            fds.push_back({ receiver.port->getFD(), POLLIN, 0 });
+        }
+        if(_ready.empty())
+        {
+            ::poll(fds.data(), fds.size(), timeout < EVENT_LOOP_TICK ? timeout : EVENT_LOOP_TICK);
+        }
+        for(auto &receiver : _receivers)
+        {
+            // process() also times out unanswered requests
+            receiver.gps->process();
+        }
+        submitDeferred();
+        while(!_ready.empty())
+        {
+            std::coroutine_handle<> handle = _ready.front();
+            _ready.pop_front();
+            handle.resume();
+        }
+    }
+
+    void run()
+    {
+        _running = true;
+        while(_running)
+        {
+            runOnce();
+        }
+    }
+
+    void stop()
+    {
+        _running = false;
+    }
+
+private:
+    struct receiver
+    {
+        ubGPSTime *gps;
+        ubGPSLinuxSerial *port;
+    };
+    struct deferred
+    {
+        ubGPSTime *gps;
+        std::function<bool()> request;
+    };
+    std::vector<receiver> _receivers;
+    std::deque<std::coroutine_handle<>> _ready;
+    std::deque<deferred> _deferred;
+    bool _running = false;
+
+    bool isDeferred(ubGPSTime *gps)
+    {
+        return (std::any_of(_deferred.begin(), _deferred.end(), 
+            [gps](const deferred &d) { return (d.gps == gps); }));
+    }
+
+    // keeps the order per receiver, a full receiver does not block the others
+    void submitDeferred()
+    {
+        std::vector<ubGPSTime *> full;
+        for(auto it = _deferred.begin(); it != _deferred.end(); )
+        {
+            if((std::find(full.begin(), full.end(), it->gps) == full.end()) && it->request())
+            {
+                it = _deferred.erase(it);
+            }
+            else
+            {
+                full.push_back(it->gps);
+                ++it;
+            }
+        }
+    }
+};
+
+// awaitable operations on one receiver
+class ubGPSAsync
+{
+public:
+    ubGPSAsync(ubGPSTime &gps, ubGPSEventLoop &loop) : _gps(gps), _loop(loop)
+    {
+    }
+
+    // resumes with the decoded message or std::nullopt on timeout
+    // the timeout starts when the request is submitted, requests wait while the table is full
+    template<typename M>
+    class pollAwaiter
+    {
+    public:
+        pollAwaiter(ubGPSAsync &async, uint32_t timeout) : _async(async), _timeout(timeout)
+        {
+        }
+
+        bool await_ready() 
+        { 
+            return (false); 
+        }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            _handle = handle;
+            _async._loop.submit(_async._gps, [this]() 
+            {
+                return (_async._gps.poll(M::msgClass, M::msgID, &pollAwaiter::onResponse, this, _timeout));
+            });
+        }
+
+        std::optional<typename M::type> await_resume()
+        {
+            return (_result);
+        }
+
+    private:
+        ubGPSAsync &_async;
+        uint32_t _timeout;
+        std::coroutine_handle<> _handle;
+        std::optional<typename M::type> _result;
+
+        static void onResponse(uint8_t, uint8_t, UBXMESSAGE *message, void *context)
+        {
+            pollAwaiter *self = static_cast<pollAwaiter *>(context);
+            if(message)
+            {
+                // the message handlers already updated the receiver data
+                self->_result = M::get(self->_async._gps);
+            }
+            self->_async._loop.schedule(self->_handle);
+        }
+    };
+
+    // resumes with true on ACK, false on NACK or timeout
+    class rateAwaiter
+    {
+    public:
+        rateAwaiter(ubGPSAsync &async, uint8_t msgClass, uint8_t msgID, uint8_t rate, uint32_t timeout) :
+            _async(async), _msgClass(msgClass), _msgID(msgID), _rate(rate), _timeout(timeout)
+        {
+        }
+
+        bool await_ready() 
+        { 
+            return (false); 
+        }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            _handle = handle;
+            _async._loop.submit(_async._gps, [this]() 
+            {
+                return (_async._gps.setMessageRate(_msgClass, _msgID, _rate, &rateAwaiter::onResponse, this, _timeout));
+            });
+        }
+
+        bool await_resume()
+        {
+            return (_result);
+        }
+
+    private:
+        ubGPSAsync &_async;
+        uint8_t _msgClass;
+        uint8_t _msgID;
+        uint8_t _rate;
+        uint32_t _timeout;
+        std::coroutine_handle<> _handle;
+        bool _result = false;
+
+        static void onResponse(uint8_t, uint8_t, UBXMESSAGE *message, void *context)
+        {
+            rateAwaiter *self = static_cast<rateAwaiter *>(context);
+            self->_result = message && (message->msgID == UBX_ACK_ACK);
+            self->_async._loop.schedule(self->_handle);
+        }
+    };
+
+    template<typename M>
+    pollAwaiter<M> poll(uint32_t timeout = POLL_TIMEOUT)
+    {
+        return (pollAwaiter<M>(*this, timeout));
+    }
+
+    rateAwaiter setRate(uint8_t msgClass, uint8_t msgID, uint8_t rate, uint32_t timeout = POLL_TIMEOUT)
+    {
+        return (rateAwaiter(*this, msgClass, msgID, rate, timeout));
+    }
+
+    ubGPSTime &gps()
+    {
+        return (_gps);
+    }
+
+private:
+    ubGPSTime &_gps;
+    ubGPSEventLoop &_loop;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,453 @@
+// ubGPSTime
+// get utc time from u-blox gps module
+// designed for nixie clocks...
+// Version 0.1.3 (alpha)
+
+// MIT license
+// Copyright 2021 highvoltglow
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), to deal in the Software without restriction, 
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, 
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software 
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR 
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#if defined(__linux__)
+
+#include <ubGPSTimeBroadcast.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+// registration requests sent by subscribers
+const char BROADCAST_SUBSCRIBE = 'S';
+const char BROADCAST_UNSUBSCRIBE = 'U';
+
+// monotonic clock in ns, shared by all processes of the host
+static uint64_t monotonicTime()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec);
+}
+
+// constructor
+ubGPSTimePublisher::ubGPSTimePublisher() :
+    _ring(nullptr), _name(), _socketPath(), _socket(-1), _subscriberCount(0), _stats()
+{
+}
+
+// destructor
+ubGPSTimePublisher::~ubGPSTimePublisher()
+{
+    close();
+}
+
+// creates the broadcast ring and the notification socket
+bool ubGPSTimePublisher::open(const char *name, const char *socketPath)
+{
+    close();
+    strncpy(_name, name, sizeof(_name) - 1);
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if(fd < 0)
+    {
+        return (false);
+    }
+    if(ftruncate(fd, sizeof(BROADCASTRING)) < 0)
+    {
+        ::close(fd);
+        return (false);
+    }
+    void *ring = mmap(nullptr, sizeof(BROADCASTRING), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(ring == MAP_FAILED)
+    {
+        return (false);
+    }
+    _ring = (BROADCASTRING *) ring;
+    memset(_ring, 0, sizeof(BROADCASTRING));
+    _ring->version = BROADCAST_VERSION;
+    _ring->slots = BROADCAST_SLOTS;
+    _ring->slotSize = BROADCAST_SLOT_SIZE;
+    __sync_synchronize();
+    _ring->magic = BROADCAST_MAGIC;
+
+    struct sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socketPath, sizeof(address.sun_path) - 1);
+    strncpy(_socketPath, socketPath, sizeof(_socketPath) - 1);
+    unlink(socketPath);
+    _socket = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if((_socket < 0) || (bind(_socket, (struct sockaddr *) &address, sizeof(address)) < 0))
+    {
+        close();
+        return (false);
+    }
+    return (true);
+}
+
+// removes the ring and the socket
+void ubGPSTimePublisher::close()
+{
+    if(_socket >= 0)
+    {
+        ::close(_socket);
+        _socket = -1;
+        unlink(_socketPath);
+    }
+    if(_ring)
+    {
+        munmap(_ring, sizeof(BROADCASTRING));
+        _ring = nullptr;
+        shm_unlink(_name);
+    }
+    _subscriberCount = 0;
+    _stats.subscribers = 0;
+}
+
+// socket to wait for subscriber registrations
+int ubGPSTimePublisher::getFD()
+{
+    return (_socket);
+}
+
+// handles subscriber registrations
+void ubGPSTimePublisher::process()
+{
+    char request;
+    struct sockaddr_un address;
+    socklen_t length = sizeof(address);
+
+    while((_socket >= 0) && 
+        (recvfrom(_socket, &request, 1, 0, (struct sockaddr *) &address, &length) == 1))
+    {
+        uint32_t i = 0;
+        while((i < _subscriberCount) && ((_subscriberLength[i] != length) || 
+            (memcmp(&_subscribers[i], &address, length) != 0)))
+        {
+            i++;
+        }
+        if((request == BROADCAST_SUBSCRIBE) && (i == _subscriberCount) && 
+            (_subscriberCount < BROADCAST_MAX_SUBSCRIBERS))
+        {
+            _subscribers[_subscriberCount] = address;
+            _subscriberLength[_subscriberCount] = length;
+            _subscriberCount++;
+        }
+        else if((request == BROADCAST_UNSUBSCRIBE) && (i < _subscriberCount))
+        {
+            removeSubscriber(i);
+        }
+        _stats.subscribers = _subscriberCount;
+        length = sizeof(address);
+    }
+}
+
+// removes a subscriber from the notification list
+void ubGPSTimePublisher::removeSubscriber(uint32_t index)
+{
+    _subscriberCount--;
+    _subscribers[index] = _subscribers[_subscriberCount];
+    _subscriberLength[index] = _subscriberLength[_subscriberCount];
+    _stats.subscribers = _subscriberCount;
+}
+
+// publishes date/time information
+void ubGPSTimePublisher::publishTimeUTC(const TIMEUTC &time)
+{
+    publish(BROADCAST_TIMEUTC, (const uint8_t *) &time, sizeof(time));
+}
+
+// publishes GPS status information
+void ubGPSTimePublisher::publishGPSStatus(const GPSSTATUS &status)
+{
+    publish(BROADCAST_GPSSTATUS, (const uint8_t *) &status, sizeof(status));
+}
+
+// publishes a complete UBX frame
+void ubGPSTimePublisher::publishMessage(UBXMESSAGE *message)
+{
+    uint8_t frame[BROADCAST_SLOT_SIZE];
+    if(message->payloadLength > BROADCAST_SLOT_SIZE - UBX_FRAME_OVERHEAD)
+    {
+        return;
+    }
+    frame[0] = message->header1;
+    frame[1] = message->header2;
+    frame[2] = message->msgClass;
+    frame[3] = message->msgID;
+    frame[4] = message->payloadLength & 0xFF;
+    frame[5] = message->payloadLength >> 8;
+    if(message->payloadLength)
+    {
+        memcpy(&frame[6], message->payload, message->payloadLength);
+    }
+    frame[6 + message->payloadLength] = message->CK_A;
+    frame[7 + message->payloadLength] = message->CK_B;
+    publish(BROADCAST_FRAME, frame, UBX_FRAME_OVERHEAD + message->payloadLength);
+}
+
+// writes an entry into the ring and notifies the subscribers
+void ubGPSTimePublisher::publish(uint16_t type, const uint8_t *data, uint16_t length)
+{
+    if(!_ring || (length > BROADCAST_SLOT_SIZE))
+    {
+        return;
+    }
+    uint64_t start = monotonicTime();
+    uint64_t number = _ring->head + 1;
+    BROADCASTSLOT *slot = &_ring->slot[number % BROADCAST_SLOTS];
+
+    slot->sequence = 2 * number - 1;
+    __sync_synchronize();
+    slot->publishTime = start;
+    slot->type = type;
+    slot->length = length;
+    memcpy(slot->data, data, length);
+    __sync_synchronize();
+    slot->sequence = 2 * number;
+    _ring->head = number;
+
+    notify();
+    _stats.published++;
+    _stats.lastPublishTime = (uint32_t)(monotonicTime() - start);
+    if(_stats.lastPublishTime > _stats.maxPublishTime)
+    {
+        _stats.maxPublishTime = _stats.lastPublishTime;
+    }
+}
+
+// wakes up all subscribers without ever blocking
+// a full socket buffer means the subscriber is already awake, gone subscribers are removed
+void ubGPSTimePublisher::notify()
+{
+    char signal = 0;
+    uint32_t i = 0;
+    while(i < _subscriberCount)
+    {
+        if(sendto(_socket, &signal, 1, MSG_DONTWAIT | MSG_NOSIGNAL,
+            (struct sockaddr *) &_subscribers[i], _subscriberLength[i]) < 0)
+        {
+            if((errno == EAGAIN) || (errno == EWOULDBLOCK))
+            {
+                _stats.notificationsDropped++;
+            }
+            else if((errno == ECONNREFUSED) || (errno == ENOENT))
+            {
+                removeSubscriber(i);
+                continue;
+            }
+        }
+        i++;
+    }
+}
+
+// provides access to the publisher statistics
+const BROADCASTSTATS &ubGPSTimePublisher::getStats()
+{
+    return (_stats);
+}
+
+// constructor
+ubGPSTimeSubscriber::ubGPSTimeSubscriber() :
+    _ring(nullptr), _socket(-1), _next(0), _lost(0), _sequence(0)
+{
+}
+
+// destructor
+ubGPSTimeSubscriber::~ubGPSTimeSubscriber()
+{
+    close();
+}
+
+// maps the ring read-only and registers for notifications
+// starts with the next published entry
+bool ubGPSTimeSubscriber::open(const char *name, const char *socketPath)
+{
+    close();
+    int fd = shm_open(name, O_RDONLY, 0);
+    if(fd < 0)
+    {
+        return (false);
+    }
+    // an object smaller than the ring would fault on access (SIGBUS)
+    struct stat info;
+    if((fstat(fd, &info) < 0) || (info.st_size < (off_t) sizeof(BROADCASTRING)))
+    {
+        ::close(fd);
+        return (false);
+    }
+    void *ring = mmap(nullptr, sizeof(BROADCASTRING), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(ring == MAP_FAILED)
+    {
+        return (false);
+    }
+    _ring = (const BROADCASTRING *) ring;
+    // a publisher built with a different MAX_PAYLOAD or slot count has another layout
+    if((_ring->magic != BROADCAST_MAGIC) || (_ring->version != BROADCAST_VERSION) || 
+        (_ring->slots != BROADCAST_SLOTS) || (_ring->slotSize != BROADCAST_SLOT_SIZE))
+    {
+        close();
+        return (false);
+    }
+    _next = _ring->head + 1;
+
+    // autobind to a unique abstract address, connect to the publisher
+    struct sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socketPath, sizeof(address.sun_path) - 1);
+    char request = BROADCAST_SUBSCRIBE;
+    _socket = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if((_socket < 0) || (bind(_socket, (struct sockaddr *) &address, sizeof(sa_family_t)) < 0) ||
+        (connect(_socket, (struct sockaddr *) &address, sizeof(address)) < 0))
+    {
+        close();
+        return (false);
+    }
+    if(send(_socket, &request, 1, 0) == 1)
+    {
+        return (true);
+    }
+    if(errno == EAGAIN)
+    {
+        // publisher queue full, wait until the publisher handled pending registrations
+        struct pollfd pfd = { _socket, POLLOUT, 0 };
+        if((poll(&pfd, 1, BROADCAST_SUBSCRIBE_TIMEOUT) > 0) && (send(_socket, &request, 1, 0) == 1))
+        {
+            return (true);
+        }
+    }
+    close();
+    return (false);
+}
+
+// unregisters and unmaps the ring
+void ubGPSTimeSubscriber::close()
+{
+    if(_socket >= 0)
+    {
+        char request = BROADCAST_UNSUBSCRIBE;
+        send(_socket, &request, 1, MSG_DONTWAIT);
+        ::close(_socket);
+        _socket = -1;
+    }
+    if(_ring)
+    {
+        munmap((void *) _ring, sizeof(BROADCASTRING));
+        _ring = nullptr;
+    }
+}
+
+// socket to add the subscriber to an external event loop
+int ubGPSTimeSubscriber::getFD()
+{
+    return (_socket);
+}
+
+// blocks until the publisher signals new entries or timeout
+bool ubGPSTimeSubscriber::wait(int timeout)
+{
+    if(!_ring)
+    {
+        return (false);
+    }
+    // the notification of an entry already read by peek() may still be pending, keep waiting
+    uint64_t deadline = monotonicTime() + (uint64_t) timeout * 1000000ULL;
+    drain();
+    while(_ring->head < _next)
+    {
+        int remaining = timeout;
+        if(timeout >= 0)
+        {
+            uint64_t now = monotonicTime();
+            remaining = now < deadline ? (int)((deadline - now + 999999) / 1000000) : 0;
+        }
+        struct pollfd pfd = { _socket, POLLIN, 0 };
+        if(poll(&pfd, 1, remaining) <= 0)
+        {
+            break;
+        }
+        drain();
+    }
+    return (_ring->head >= _next);
+}
+
+// removes pending notifications, the ring holds the data
+void ubGPSTimeSubscriber::drain()
+{
+    char signal[16];
+    while(recv(_socket, signal, sizeof(signal), MSG_DONTWAIT) > 0)
+    {
+    }
+}
+
+// zero copy access to the next entry
+const BROADCASTSLOT *ubGPSTimeSubscriber::peek()
+{
+    while(_ring)
+    {
+        uint64_t head = _ring->head;
+        if(head < _next)
+        {
+            return (nullptr);
+        }
+        if(head - _next >= BROADCAST_SLOTS)
+        {
+            // overrun by the publisher, skip to the oldest entry still in the ring
+            _lost += head - _next - BROADCAST_SLOTS + 1;
+            _next = head - BROADCAST_SLOTS + 1;
+        }
+        const BROADCASTSLOT *slot = &_ring->slot[_next % BROADCAST_SLOTS];
+        _sequence = slot->sequence;
+        __sync_synchronize();
+        if(_sequence == 2 * _next)
+        {
+            return (slot);
+        }
+        // overwritten in the meantime
+        _lost++;
+        _next++;
+    }
+    return (nullptr);
+}
+
+// releases the entry returned by peek()
+bool ubGPSTimeSubscriber::consume()
+{
+    if(!_ring)
+    {
+        return (false);
+    }
+    __sync_synchronize();
+    bool valid = (_ring->slot[_next % BROADCAST_SLOTS].sequence == _sequence);
+    if(!valid)
+    {
+        _lost++;
+    }
+    _next++;
+    return (valid);
+}
+
+// number of entries missed because the subscriber was too slow
+uint64_t ubGPSTimeSubscriber::getLost()
+{
+    return (_lost);
+}
+
+#endif
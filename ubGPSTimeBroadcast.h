@@ -0,0 +1,154 @@
+// ubGPSTime
+// get utc time from u-blox gps module
+// designed for nixie clocks...
+// Version 0.1.3 (alpha)
+
+// MIT license
+// Copyright 2021 highvoltglow
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), to deal in the Software without restriction, 
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, 
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software 
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR 
+// OTHER DEALINGS IN THE SOFTWARE.
+
+// local fan-out of decoded time to many processes (Linux host builds)
+// one publisher owns the serial port and writes updates into a broadcast ring in shared memory,
+// subscribers map the ring read-only and get woken up through a Unix datagram socket
+// slow subscribers lose old entries instead of blocking the publisher
+
+#ifndef UBGPSTIMEBROADCAST_H
+#define UBGPSTIMEBROADCAST_H
+
+#if defined(__linux__)
+
+#include <Arduino.h>
+#include <ubGPSTime.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define BROADCAST_NAME "/ubgpstime" // shared memory object
+#define BROADCAST_SOCKET "/tmp/ubgpstime.sock" // notification socket of the publisher
+#define BROADCAST_SLOTS 64
+#define BROADCAST_SLOT_SIZE (MAX_PAYLOAD + UBX_FRAME_OVERHEAD)
+#define BROADCAST_MAX_SUBSCRIBERS 128
+#define BROADCAST_SUBSCRIBE_TIMEOUT 1000 // ms
+#define BROADCAST_MAGIC 0x55424754 // "UBGT"
+#define BROADCAST_VERSION 1
+
+// broadcast entry types
+const uint16_t BROADCAST_TIMEUTC = 1;
+const uint16_t BROADCAST_GPSSTATUS = 2;
+const uint16_t BROADCAST_FRAME = 3; // raw UBX frame
+
+// ring entry, sequence is odd while the publisher writes the entry
+typedef struct
+{
+    volatile uint64_t sequence;
+    uint64_t publishTime; // CLOCK_MONOTONIC ns
+    uint16_t type;
+    uint16_t length;
+    uint8_t data[BROADCAST_SLOT_SIZE];
+}
+BROADCASTSLOT;
+
+// shared memory layout
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slots;
+    uint32_t slotSize;
+    volatile uint64_t head; // number of published entries
+    BROADCASTSLOT slot[BROADCAST_SLOTS];
+}
+BROADCASTRING;
+
+// publisher statistics
+typedef struct
+{
+    uint64_t published;
+    uint32_t subscribers;
+    uint32_t notificationsDropped; // subscriber socket buffer full
+    uint32_t lastPublishTime; // ns for ring write and all notifications
+    uint32_t maxPublishTime;
+}
+BROADCASTSTATS;
+
+class ubGPSTimePublisher
+{
+public:
+    ubGPSTimePublisher();
+    ~ubGPSTimePublisher();
+
+    bool open(const char *name = BROADCAST_NAME, const char *socketPath = BROADCAST_SOCKET);
+    void close();
+
+    // handles subscriber registrations, call it from the main loop
+    void process();
+    int getFD();
+
+    void publishTimeUTC(const TIMEUTC &time);
+    void publishGPSStatus(const GPSSTATUS &status);
+    void publishMessage(UBXMESSAGE *message);
+    void publish(uint16_t type, const uint8_t *data, uint16_t length);
+
+    const BROADCASTSTATS &getStats();
+
+private:
+    BROADCASTRING *_ring;
+    char _name[64];
+    char _socketPath[sizeof(((struct sockaddr_un *) 0)->sun_path)];
+    int _socket;
+    struct sockaddr_un _subscribers[BROADCAST_MAX_SUBSCRIBERS];
+    socklen_t _subscriberLength[BROADCAST_MAX_SUBSCRIBERS];
+    uint32_t _subscriberCount;
+    BROADCASTSTATS _stats;
+
+    void notify();
+    void removeSubscriber(uint32_t index);
+};
+
+class ubGPSTimeSubscriber
+{
+public:
+    ubGPSTimeSubscriber();
+    ~ubGPSTimeSubscriber();
+
+    bool open(const char *name = BROADCAST_NAME, const char *socketPath = BROADCAST_SOCKET);
+    void close();
+    int getFD();
+
+    // blocks until the publisher signals new entries or timeout (ms, -1 waits forever)
+    bool wait(int timeout);
+
+    // zero copy access to the next entry, nullptr if there is none
+    // consume() returns false if the entry was overwritten while it was read
+    const BROADCASTSLOT *peek();
+    bool consume();
+
+    uint64_t getLost();
+
+private:
+    const BROADCASTRING *_ring;
+    int _socket;
+    uint64_t _next; // number of the next entry to read
+    uint64_t _lost;
+    uint64_t _sequence;
+
+    void drain();
+};
+
+#endif
+
+#endif
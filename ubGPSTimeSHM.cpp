@@ -0,0 +1,171 @@
+// ubGPSTime
+// get utc time from u-blox gps module
+// designed for nixie clocks...
+// Version 0.1.3 (alpha)
+
+// MIT license
+// Copyright 2021 highvoltglow
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), to deal in the Software without restriction, 
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, 
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software 
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR 
+
+#if defined(__linux__)
+
+#include <ubGPSTimeSHM.h>
+#include <math.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+// constructor
+ubGPSTimeSHM::ubGPSTimeSHM() :
+    _shmID(-1), _shm(nullptr), _maxAccuracy(SHM_MAX_ACCURACY), 
+    _stats(), _m2(0), _jitterSum(0)
+{
+}
+
+// destructor
+ubGPSTimeSHM::~ubGPSTimeSHM()
+{
+    close();
+}
+
+// attaches to (or creates) the shared memory segment of the given unit
+// units 0 and 1 are only accessible by root, as expected by chrony and ntpd
+bool ubGPSTimeSHM::open(uint8_t unit)
+{
+    close();
+    _shmID = shmget(SHM_KEY_BASE + unit, sizeof(SHMTIME), IPC_CREAT | (unit < 2 ? 0600 : 0666));
+    if(_shmID < 0)
+    {
+        return (false);
+    }
+    void *shm = shmat(_shmID, nullptr, 0);
+    if(shm == (void *) -1)
+    {
+        _shmID = -1;
+        return (false);
+    }
+    _shm = (SHMTIME *) shm;
+    _shm->mode = 1;
+    _shm->valid = 0;
+    _shm->precision = SHM_PRECISION;
+    _shm->nsamples = 3;
+    return (true);
+}
+
+// detaches from the segment, the segment itself stays for the time server
+void ubGPSTimeSHM::close()
+{
+    if(_shm)
+    {
+        shmdt(_shm);
+        _shm = nullptr;
+    }
+    _shmID = -1;
+}
+
+// returns true if attached to the segment
+bool ubGPSTimeSHM::isOpen()
+{
+    return (_shm != nullptr);
+}
+
+// sets the time accuracy threshold in ns
+void ubGPSTimeSHM::setMaxAccuracy(uint32_t maxAccuracy)
+{
+    _maxAccuracy = maxAccuracy;
+}
+
+// writes GPS time and receive time to the segment
+bool ubGPSTimeSHM::update(const TIMEUTC &time)
+{
+    if(!time.utcValid || (time.accuracy > _maxAccuracy))
+    {
+        _stats.rejected++;
+        return (false);
+    }
+
+    // receive time: realtime clock now minus the age of the start of frame timestamp
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    int64_t receiveNSec = (int64_t) now.tv_sec * 1000000000LL + now.tv_nsec - 
+        (int64_t)(uint32_t)(micros() - time.rxTimestamp) * 1000LL;
+
+    // GPS time, nanoSecond is a signed correction of the full seconds
+    struct tm utc = {};
+    utc.tm_year = time.year - 1900;
+    utc.tm_mon = time.month - 1;
+    utc.tm_mday = time.day;
+    utc.tm_hour = time.hour;
+    utc.tm_min = time.minute;
+    utc.tm_sec = time.second;
+    int64_t clockNSec = (int64_t) timegm(&utc) * 1000000000LL + time.nanoSecond;
+
+    updateStats((double)(clockNSec - receiveNSec) / 1e9);
+
+    if(!_shm)
+    {
+        return (false);
+    }
+    // count/valid handshake, readers discard the sample if count changed while reading
+    _shm->valid = 0;
+    _shm->count = _shm->count + 1;
+    __sync_synchronize();
+    _shm->clockTimeStampSec = (time_t)(clockNSec / 1000000000LL);
+    _shm->clockTimeStampNSec = (unsigned)(clockNSec % 1000000000LL);
+    _shm->clockTimeStampUSec = (int)(_shm->clockTimeStampNSec / 1000);
+    _shm->receiveTimeStampSec = (time_t)(receiveNSec / 1000000000LL);
+    _shm->receiveTimeStampNSec = (unsigned)(receiveNSec % 1000000000LL);
+    _shm->receiveTimeStampUSec = (int)(_shm->receiveTimeStampNSec / 1000);
+    _shm->leap = 0;
+    _shm->precision = SHM_PRECISION;
+    __sync_synchronize();
+    _shm->count = _shm->count + 1;
+    _shm->valid = 1;
+    return (true);
+}
+
+// updates mean and standard deviation (Welford) and jitter of the offsets
+void ubGPSTimeSHM::updateStats(double offset)
+{
+    double previous = _stats.offset;
+    _stats.samples++;
+    _stats.offset = offset;
+    double delta = offset - _stats.meanOffset;
+    _stats.meanOffset += delta / _stats.samples;
+    _m2 += delta * (offset - _stats.meanOffset);
+    if(_stats.samples > 1)
+    {
+        _stats.stdDev = sqrt(_m2 / (_stats.samples - 1));
+        _jitterSum += (offset - previous) * (offset - previous);
+        _stats.jitter = sqrt(_jitterSum / (_stats.samples - 1));
+    }
+}
+
+// provides access to the offset statistics
+const REFCLOCKSTATS &ubGPSTimeSHM::getStats()
+{
+    return (_stats);
+}
+
+// clears the offset statistics
+void ubGPSTimeSHM::resetStats()
+{
+    _stats = {};
+    _m2 = 0;
+    _jitterSum = 0;
+}
+
+#endif
@@ -0,0 +1,104 @@
+// ubGPSTime
+// get utc time from u-blox gps module
+// designed for nixie clocks...
+// Version 0.1.3 (alpha)
+
+// MIT license
+// Copyright 2021 highvoltglow
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software 
+// and associated documentation files (the "Software"), to deal in the Software without restriction, 
+// including without limitation the rights to use, copy, modify, merge, publish, distribute, 
+// sublicense, and/or sell copies of the Software, and to permit persons to whom the Software 
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies 
+// or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+// INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+// PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+// FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR 
+
+// NTP shared memory reference clock for chrony/ntpd (Linux host builds)
+// chrony: refclock SHM 0 offset 0.0 delay 0.2 refid GPS
+// ntpd:   server 127.127.28.0
+
+#ifndef UBGPSTIMESHM_H
+#define UBGPSTIMESHM_H
+
+#if defined(__linux__)
+
+#include <Arduino.h>
+#include <ubGPSTime.h>
+#include <time.h>
+
+#define SHM_KEY_BASE 0x4e545030 // "NTP0"
+#define SHM_MAX_ACCURACY 1000000 // 1 ms, time accuracy estimate threshold in ns
+#define SHM_PRECISION -10 // about 1 ms, limited by the serial receive timestamp
+
+// segment layout shared with chrony and ntpd
+typedef struct
+{
+    int mode; // 1: count/valid handshake
+    volatile int count;
+    time_t clockTimeStampSec; // GPS time
+    int clockTimeStampUSec;
+    time_t receiveTimeStampSec; // local time when the message was received
+    int receiveTimeStampUSec;
+    int leap;
+    int precision;
+    int nsamples;
+    volatile int valid;
+    unsigned clockTimeStampNSec;
+    unsigned receiveTimeStampNSec;
+    int dummy[8];
+}
+SHMTIME;
+
+// offset statistics, GPS time - receive time in seconds
+typedef struct
+{
+    uint32_t samples;
+    uint32_t rejected;
+    double offset; // last offset
+    double meanOffset;
+    double stdDev;
+    double jitter; // RMS of the difference between consecutive offsets
+}
+REFCLOCKSTATS;
+
+class ubGPSTimeSHM
+{
+public:
+    ubGPSTimeSHM();
+    ~ubGPSTimeSHM();
+
+    bool open(uint8_t unit = 0);
+    void close();
+    bool isOpen();
+
+    void setMaxAccuracy(uint32_t maxAccuracy);
+
+    // writes a sample if UTC is valid and the accuracy is within threshold
+    // call it from the message callback after NAV-TIMEUTC or NAV-PVT
+    bool update(const TIMEUTC &time);
+
+    const REFCLOCKSTATS &getStats();
+    void resetStats();
+
+private:
+    int _shmID;
+    SHMTIME *_shm;
+    uint32_t _maxAccuracy;
+    REFCLOCKSTATS _stats;
+    double _m2;
+    double _jitterSum;
+
+    void updateStats(double offset);
+};
+
+#endif
+
+#endif